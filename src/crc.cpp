@@ -0,0 +1,133 @@
+// Copyright © 2020-2023 Miguel González Cuadrado <mgcuadrado@gmail.com>
+
+// This file is part of Testudo.
+
+//     Testudo is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+
+//     Testudo is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+
+//     You should have received a copy of the GNU General Public License
+//     along with Testudo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "crc.h"
+
+#if defined(__x86_64__) and (defined(__GNUC__) or defined(__clang__))
+#define CRC_CLMUL_KERNEL
+#include <immintrin.h>
+#endif
+
+namespace cyclic_redundancy_check {
+
+  using namespace std;
+
+#ifdef CRC_CLMUL_KERNEL
+
+  // folding (see "Fast CRC Computation for Generic Polynomials Using
+  // PCLMULQDQ Instruction", by Gopal et al., Intel, 2009): a 128-bit block
+  // "H·x^64+L" followed by "d" bits of data is congruent, modulo the CRC
+  // polynomial "P", with "H·(x^(d+64) mod P)+L·(x^d mod P)" in their place,
+  // which is a 127-bit product that can be xor'ed into the block "d" bits
+  // ahead; in the reflected representation, a carry-less multiplication
+  // yields the product shifted by one bit, which is compensated by using
+  // "x^(d+63)" and "x^(d-1)" as constants; four blocks are folded in
+  // parallel, 512 bits ahead, then folded into one, 128 bits ahead, and the
+  // last block is reduced with the tables
+
+  namespace {
+
+    // "x^n mod P", in the reflected representation
+    crc64_t x_to_the_n_mod_p(unsigned n) {
+      crc64_t v=crc64_t(1) << 63; // "x^0"
+      for (unsigned i=0; i<n; ++i)
+        v=(v >> 1) xor ((v bitand 0x1) * reversed_crc64);
+      return v;
+    }
+
+    __attribute__((target("pclmul,sse2")))
+    __m128i fold_constants(unsigned d) {
+      return _mm_set_epi64x(static_cast<long long>(x_to_the_n_mod_p(d-1)),
+                            static_cast<long long>(x_to_the_n_mod_p(d+63)));
+    }
+
+    __attribute__((target("pclmul,sse2")))
+    __m128i load(char const *p)
+      { return _mm_loadu_si128(reinterpret_cast<__m128i const *>(p)); }
+
+    __attribute__((target("pclmul,sse2")))
+    __m128i fold(__m128i block, __m128i constants, __m128i ahead) {
+      return _mm_xor_si128(
+        _mm_xor_si128(_mm_clmulepi64_si128(block, constants, 0x00),
+                      _mm_clmulepi64_si128(block, constants, 0x11)),
+        ahead);
+    }
+
+    __attribute__((target("pclmul,sse2")))
+    crc64_t crc64_clmul_kernel(string_view s, crc64_t previous) {
+      static __m128i const
+        fold_by_4=fold_constants(4*128),
+        fold_by_1=fold_constants(128);
+      char const *p=s.data();
+      size_t size=s.size();
+      // the initial CRC value goes into the first 64 bits
+      __m128i
+        b0=_mm_xor_si128(load(p),
+                         _mm_cvtsi64_si128(
+                           static_cast<long long>(compl previous))),
+        b1=load(p+16), b2=load(p+32), b3=load(p+48);
+      for (p+=64, size-=64; size>=64; p+=64, size-=64) {
+        b0=fold(b0, fold_by_4, load(p));
+        b1=fold(b1, fold_by_4, load(p+16));
+        b2=fold(b2, fold_by_4, load(p+32));
+        b3=fold(b3, fold_by_4, load(p+48));
+      }
+      b0=fold(b0, fold_by_1, b1);
+      b0=fold(b0, fold_by_1, b2);
+      b0=fold(b0, fold_by_1, b3);
+      for (; size>=16; p+=16, size-=16)
+        b0=fold(b0, fold_by_1, load(p));
+      // the last block is reduced from a zero CRC value (which is "compl
+      // 0" as a previous CRC), and then the rest of the data
+      alignas(16) char last[16];
+      _mm_store_si128(reinterpret_cast<__m128i *>(last), b0);
+      crc64_t crc=crc64_slicing_by_16({last, sizeof(last)}, compl crc64_t(0));
+      return crc64_slicing_by_16({p, size}, crc);
+    }
+
+  }
+
+  bool crc64_clmul_supported() {
+    static bool const supported=
+      __builtin_cpu_supports("pclmul") and __builtin_cpu_supports("sse2");
+    return supported;
+  }
+
+  crc64_t crc64_clmul(string_view s, crc64_t previous) {
+    // below this size, setting up the folding takes longer than the tables
+    size_t const min_size=64;
+    if ((s.size()<min_size) or not crc64_clmul_supported())
+      return crc64_slicing_by_16(s, previous);
+    return crc64_clmul_kernel(s, previous);
+  }
+
+#else
+
+  bool crc64_clmul_supported() { return false; }
+
+  crc64_t crc64_clmul(string_view s, crc64_t previous)
+    { return crc64_slicing_by_16(s, previous); }
+
+#endif
+
+  crc64_t crc64(string_view s, crc64_t previous) {
+    static auto const implementation=
+      crc64_clmul_supported() ? crc64_clmul : crc64_slicing_by_16;
+    return implementation(s, previous);
+  }
+
+}
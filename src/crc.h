@@ -19,7 +19,9 @@
 #define MGCUADRADO_CRC_HEADER_
 
 #include <string>
+#include <string_view>
 #include <cstdint>
+#include <cstddef>
 
 namespace cyclic_redundancy_check {
 
@@ -30,13 +32,24 @@ namespace cyclic_redundancy_check {
       crc_t data[0x100];
     };
 
+    // "data[k]" is the table for the k-th byte before the last one of a
+    // block, for slicing-by-"n" (see "crc_slicing_n()" below)
+    template <typename crc_t, std::size_t n>
+    struct slicing_table_t {
+      byte_table_t<crc_t> data[n];
+    };
+
   }
 
+  // the CRC functions take the CRC of the data that comes before (or 0, if
+  // none), so that a CRC can be computed incrementally, without building
+  // the whole string: "crc64(b, crc64(a))==crc64(a+b)"
+
   /// crc32: CRC-32 (en.wikipedia.org/wiki/Cyclic_redundancy_check)
 
   using crc32_t=std::uint32_t;
 
-  crc32_t crc32(std::string); // CRC-32 of a string
+  crc32_t crc32(std::string_view, crc32_t previous=0); // CRC-32 of a string
 
   implementation::byte_table_t<crc32_t>
   crc32_table(); // exposed only for debugging and validation
@@ -45,11 +58,25 @@ namespace cyclic_redundancy_check {
 
   using crc64_t=std::uint64_t;
 
-  crc64_t crc64(std::string); // CRC-64-ECMA of a string
+  // CRC-64-ECMA of a string; it uses "crc64_clmul()" if the processor
+  // supports it, and "crc64_slicing_by_16()" otherwise
+  crc64_t crc64(std::string_view, crc64_t previous=0);
 
   implementation::byte_table_t<crc64_t>
   crc64_table(); // exposed only for debugging and validation
 
+  // the different implementations of "crc64()", exposed only for validation
+  // and benchmarking: one byte at a time, with a single table; 8 or 16
+  // bytes at a time, with 8 or 16 tables; and 64 bytes at a time, folding
+  // with carry-less multiplications (the "PCLMULQDQ" instruction of x86-64
+  // processors), which falls back to slicing-by-16 for short strings, or if
+  // not "crc64_clmul_supported()"
+  crc64_t crc64_bytewise(std::string_view, crc64_t previous=0);
+  crc64_t crc64_slicing_by_8(std::string_view, crc64_t previous=0);
+  crc64_t crc64_slicing_by_16(std::string_view, crc64_t previous=0);
+  crc64_t crc64_clmul(std::string_view, crc64_t previous=0);
+  bool crc64_clmul_supported();
+
   /// crc32 and crc64
 
   // format:
@@ -61,7 +88,7 @@ namespace cyclic_redundancy_check {
   template <typename crc_t>
   std::string to_hex(crc_t i);
   template <typename crc_t>
-  crc_t hex_to(std::string s);
+  crc_t hex_to(std::string_view s);
 
   /// implementation
 
@@ -80,14 +107,53 @@ namespace cyclic_redundancy_check {
     }
 
     template <typename crc_t, crc_t reversed>
-    crc_t crc_n(std::string s) {
-      static auto table=crc_table_n<crc_t>(reversed);
-      crc_t crc=compl 0;
+    crc_t crc_n(std::string_view s, crc_t previous) {
+      static auto const table=crc_table_n<crc_t>(reversed);
+      crc_t crc=compl previous;
       for (unsigned char c: s)
         crc=(crc >> 8) xor table.data[(crc bitand 0xff) xor c];
       return compl crc;
     }
 
+    template <typename crc_t, std::size_t n>
+    slicing_table_t<crc_t, n> slicing_table_n(crc_t reversed) {
+      slicing_table_t<crc_t, n> table;
+      table.data[0]=crc_table_n<crc_t>(reversed);
+      for (std::size_t k=1; k<n; ++k)
+        for (int i=0; i<0x100; ++i) {
+          crc_t v=table.data[k-1].data[i];
+          table.data[k].data[i]=(v >> 8) xor table.data[0].data[v bitand 0xff];
+        }
+      return table;
+    }
+
+    // slicing-by-"n": each block of "n" bytes is processed at once, by
+    // looking up every byte (xor'ed with the corresponding byte of the CRC,
+    // for the first ones) in its own table, which accounts for the bytes
+    // that come after it in the block; the bytes are read one by one, so it
+    // doesn't depend on the endianness
+    template <typename crc_t, crc_t reversed, std::size_t n>
+    crc_t crc_slicing_n(std::string_view s, crc_t previous) {
+      static_assert(n>=sizeof(crc_t));
+      static auto const table=slicing_table_n<crc_t, n>(reversed);
+      crc_t crc=compl previous;
+      auto p=reinterpret_cast<unsigned char const *>(s.data());
+      std::size_t size=s.size();
+      for (; size>=n; size-=n, p+=n) {
+        crc_t next=0;
+        for (std::size_t i=0; i<n; ++i) {
+          unsigned x=p[i];
+          if (i<sizeof(crc_t))
+            x^=unsigned(crc >> (8*i)) bitand 0xff;
+          next^=table.data[n-1-i].data[x];
+        }
+        crc=next;
+      }
+      for (; size>0; --size, ++p)
+        crc=(crc >> 8) xor table.data[0].data[(crc bitand 0xff) xor *p];
+      return compl crc;
+    }
+
     template <typename>
     struct total_digits;
     template <>
@@ -110,7 +176,7 @@ namespace cyclic_redundancy_check {
   }
 
   template <typename crc_t>
-  crc_t hex_to(std::string s) {
+  crc_t hex_to(std::string_view s) {
     crc_t result=0;
     for (char c: s)
       result=result*16+((c<='9') ? (c-'0') : ((c-'a')+10));
@@ -119,17 +185,27 @@ namespace cyclic_redundancy_check {
 
   // CRC-32
   crc32_t constexpr reversed_crc32=0xedb88320;
-  inline crc32_t crc32(std::string s)
-    { return implementation::crc_n<crc32_t, reversed_crc32>(s); }
+  inline crc32_t crc32(std::string_view s, crc32_t previous) {
+    return implementation::crc_slicing_n<crc32_t, reversed_crc32, 8>(
+      s, previous);
+  }
   inline implementation::byte_table_t<crc32_t> crc32_table()
     { return implementation::crc_table_n(reversed_crc32); }
 
   // CRC-64-ECMA
   crc64_t constexpr reversed_crc64=0xc96c5795d7870f42;
-  inline crc64_t crc64(std::string s)
-    { return implementation::crc_n<crc64_t, reversed_crc64>(s); }
   inline implementation::byte_table_t<crc64_t> crc64_table()
     { return implementation::crc_table_n(reversed_crc64); }
+  inline crc64_t crc64_bytewise(std::string_view s, crc64_t previous)
+    { return implementation::crc_n<crc64_t, reversed_crc64>(s, previous); }
+  inline crc64_t crc64_slicing_by_8(std::string_view s, crc64_t previous) {
+    return implementation::crc_slicing_n<crc64_t, reversed_crc64, 8>(
+      s, previous);
+  }
+  inline crc64_t crc64_slicing_by_16(std::string_view s, crc64_t previous) {
+    return implementation::crc_slicing_n<crc64_t, reversed_crc64, 16>(
+      s, previous);
+  }
 
 }
 
@@ -17,60 +17,102 @@
 
 #include "glob_pattern.h"
 #include <stdexcept>
+#include <algorithm>
 
 namespace glob {
 
   using namespace std;
 
-  bool matches(string name, string pattern) {
-    size_t n=0, p=0; // "n": name index; "p": pattern index
-    size_t const n_s=name.size(), p_s=pattern.size();
-    while (p<p_s) {
+  bool matches(string name, string pattern)
+    { return pattern_t(pattern).matches(name); }
+
+  pattern_t::pattern_t(string const &pattern) {
+    size_t const p_s=pattern.size();
+    for (size_t p=0; p<p_s; ++p) {
       char c=pattern[p];
-      ++p;
       switch (c) {
         case '\\': {
-          if (p<p_s) {
-            char c=pattern[p];
+          if ((p+1<p_s)
+              and ((pattern[p+1]=='?') or (pattern[p+1]=='*')
+                   or (pattern[p+1]=='\\'))) {
             ++p;
-            switch(c) {
-              case '?': case '*': case '\\': {
-                if (n<n_s and name[n]==c)
-                  ++n;
-                else
-                  return false;
-              } break;
-              default: {
-                throw runtime_error("wrong wildcard at char "+to_string(p));
-              } break;
-            }
+            tokens.push_back({kind_t::one_char, pattern[p]});
+            unescaped+=pattern[p];
           }
           else
-            throw runtime_error("wrong wildcard at char "+to_string(p));
+            throw runtime_error("wrong wildcard at char "
+                                +to_string(min(p+2, p_s)));
         } break;
         case '?': {
-          if (n<n_s)
-            ++n;
-          else
-            return false;
+          tokens.push_back({kind_t::any_char, c});
+          literal=false;
         } break;
         case '*': {
-          string rest=pattern.substr(p); // past the '*'
-          for (size_t i=n; i<=n_s; ++i)
-            if (matches(name.substr(i), rest))
-              return true;
-          return false;
+          // consecutive '*' are the same as one
+          if (tokens.empty() or (tokens.back().kind not_eq kind_t::any_string))
+            tokens.push_back({kind_t::any_string, c});
+          literal=false;
         } break;
         default: {
-          if (n<n_s and name[n]==c)
-            ++n;
-          else
-            return false;
+          tokens.push_back({kind_t::one_char, c});
+          unescaped+=c;
         } break;
       }
     }
-    // pattern exhausted; match only if name also exhausted
-    return n==n_s;
+  }
+
+  bool pattern_t::matches(string_view name) const {
+    // "n": name index; "t": token index; when a token doesn't match, go back
+    // to the last '*', and make it take one more char; earlier '*' never
+    // need to be taken back to, since the last one can take whatever they
+    // would
+    size_t n=0, t=0;
+    size_t const n_s=name.size(), t_s=tokens.size();
+    size_t const no_star=size_t(-1);
+    size_t star=no_star, star_n=0;
+    while (n<n_s) {
+      if ((t<t_s) and (tokens[t].kind==kind_t::any_string)) {
+        star=t++;
+        star_n=n;
+      }
+      else if ((t<t_s)
+               and ((tokens[t].kind==kind_t::any_char)
+                    or (tokens[t].c==name[n]))) {
+        ++t;
+        ++n;
+      }
+      else if (star not_eq no_star) {
+        t=star+1;
+        n=++star_n;
+      }
+      else
+        return false;
+    }
+    // name exhausted; match only if the rest of the pattern can match nothing
+    while ((t<t_s) and (tokens[t].kind==kind_t::any_string))
+      ++t;
+    return t==t_s;
+  }
+
+  pattern_set_t::pattern_set_t(list<string> const &patterns) {
+    for (auto const &p: patterns) {
+      pattern_t pattern(p);
+      if (pattern.is_literal()) {
+        literal_texts.push_back(pattern.text());
+        literals.insert(literal_texts.back());
+      }
+      else
+        wildcards.push_back(move(pattern));
+    }
+  }
+
+  bool pattern_set_t::matches(string_view name) const {
+    if (literals.count(name))
+      return true;
+    for (auto const &pattern: wildcards)
+      if (pattern.matches(name))
+        return true;
+    return false;
   }
 
 }
@@ -19,12 +19,56 @@
 #define MGCUADRADO_GLOB_PATTERN_HEADER_
 
 #include <string>
+#include <string_view>
+#include <vector>
+#include <list>
+#include <unordered_set>
 
 namespace glob {
 
   // supported wildcards: '?', '*', '\'
   bool matches(std::string name, std::string pattern);
 
+  // a pattern, compiled once to be matched against many names; wrong
+  // wildcards throw when compiling; matching doesn't allocate, and it takes
+  // at most the length of the name times that of the pattern, instead of
+  // being exponential on the number of '*'
+  class pattern_t {
+  public:
+    explicit pattern_t(std::string const &pattern);
+    bool matches(std::string_view name) const;
+    // whether the pattern has no wildcards, so that it only matches itself
+    bool is_literal() const { return literal; }
+    std::string const &text() const { return unescaped; }
+  private:
+    enum class kind_t : char { one_char, any_char, any_string };
+    struct token_t {
+      kind_t kind;
+      char c;
+    };
+    std::vector<token_t> tokens;
+    bool literal=true;
+    std::string unescaped;
+  };
+
+  // several patterns, matched as one: a name matches if it matches any of
+  // them; patterns without wildcards are looked up in a hash set, instead of
+  // being matched one by one
+  class pattern_set_t {
+  public:
+    explicit pattern_set_t(std::list<std::string> const &patterns);
+    // copies would refer to the original's literal patterns
+    pattern_set_t(pattern_set_t const &)=delete;
+    pattern_set_t(pattern_set_t &&)=default;
+    bool empty() const { return literals.empty() and wildcards.empty(); }
+    bool matches(std::string_view name) const;
+  private:
+    std::unordered_set<std::string_view> literals;
+    std::vector<pattern_t> wildcards;
+    // the literal patterns, which the views above refer to
+    std::list<std::string> literal_texts;
+  };
+
 }
 
 #endif
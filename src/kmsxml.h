@@ -24,9 +24,16 @@
 #include "auto_weak_ptr.h"
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <list>
-#include <regex>
+#include <array>
 #include <map>
+#include <unordered_map>
+#include <memory>
+#include <algorithm>
+#include <sstream>
+#include <cstdint>
 #include <functional>
 
 #ifdef KMSXML_TEST
@@ -77,11 +84,47 @@ namespace kmsxml
       return tree_indent;
     }
 
-    // encode entity references in a text
-    inline text_t xml_encode_text(text_t t) {
-      for (auto const &[c, x]: entity_references)
-        t=std::regex_replace(t, std::regex(c), x);
-      return t;
+    // the entity reference for each character, or empty if it needs none
+    inline std::array<std::string_view, 256> const &entity_reference_table() {
+      static auto const table=[] {
+        std::array<std::string_view, 256> result{};
+        for (auto const &[c, x]: entity_references)
+          result[static_cast<unsigned char>(c[0])]=x;
+        return result;
+      }();
+      return table;
+    }
+
+    // encode entity references in a text in a single pass, calling "write"
+    // for each run of characters that need no encoding, and for each entity
+    // reference
+    template <typename W>
+    void xml_encode_text(std::string_view t, W &&write) {
+      auto const &table=entity_reference_table();
+      std::size_t run_begin=0;
+      for (std::size_t i=0; i<t.size(); ++i)
+        if (auto x=table[static_cast<unsigned char>(t[i])]; not x.empty()) {
+          if (i>run_begin)
+            write(t.substr(run_begin, i-run_begin));
+          write(x);
+          run_begin=i+1;
+        }
+      if (t.size()>run_begin)
+        write(t.substr(run_begin));
+    }
+
+    inline void xml_encode_text(std::ostream &os, std::string_view t) {
+      xml_encode_text(
+        t,
+        [&os](std::string_view s)
+          { os.write(s.data(), static_cast<std::streamsize>(s.size())); });
+    }
+
+    inline text_t xml_encode_text(std::string_view t) {
+      text_t result;
+      result.reserve(t.size());
+      xml_encode_text(t, [&result](std::string_view s) { result+=s; });
+      return result;
     }
 
   }
@@ -125,7 +168,9 @@ namespace kmsxml
     //
     //     {name}="{value}"
     void output(std::ostream &os) const {
-      os << name << "=\"" << implementation::xml_encode_text(value) << "\"";
+      os << name << "=\"";
+      implementation::xml_encode_text(os, value);
+      os << "\"";
     }
     name_t const name;
     text_t const value;
@@ -158,9 +203,9 @@ namespace kmsxml
     // text content is output in the holding element's body; if "nl", output in
     // a separate line
     void output(std::ostream &os, size_t indent, bool nl) const override {
-      os << (nl ? implementation::indent_text(indent) : "")
-         << implementation::xml_encode_text(text)
-         << (nl ? "\n" : "");
+      os << (nl ? implementation::indent_text(indent) : "");
+      implementation::xml_encode_text(os, text);
+      os << (nl ? "\n" : "");
     }
     using content_t::print_tree;
     void print_tree(std::ostream &os, size_t indent) const override {
@@ -282,161 +327,271 @@ namespace kmsxml
 
   namespace implementation {
 
-    inline text_t xml_decode_text(text_t t) {
-      std::string result;
+    // decode entity references in "t" into "out", which must have room for
+    // "t.size()" characters (decoding never lengthens a text); return the
+    // decoded size
+    inline std::size_t xml_decode_text_to(std::string_view t, char *out) {
+      std::size_t n=0;
       for (std::size_t i=0; i<t.size(); ) {
         bool entity_reference=false;
         if (t[i]=='&')
           for (auto const &[c, x]: entity_references)
             if (t.substr(i, x.size())==x) {
               entity_reference=true;
-              result+=c;
+              out[n++]=c[0];
               i+=x.size();
               break;
             }
         if (not entity_reference)
-          result+=t[i++];
+          out[n++]=t[i++];
       }
-      return result;
+      return n;
     }
 
-    template <typename F>
-    inline auto expect_char(std::istream &is, F const &f, std::string f_name) {
-      if (is.eof())
-        throw std::runtime_error("EOF while expecting "+f_name);
-      else if (char c=char(is.get()); not f(c))
-        throw std::runtime_error(std::string("unexpected '")+char(c)
-                                 +"' while expecting "+f_name);
-      else
-        return c;
-    }
-
-    inline auto expect_char(std::istream &is, char expected) {
-      return expect_char(is,
-                         [expected](auto c) { return c==expected; },
-                         std::string("'")+expected+"'");
+    inline text_t xml_decode_text(std::string_view t) {
+      text_t result(t.size(), '\0');
+      result.resize(xml_decode_text_to(t, result.data()));
+      return result;
     }
 
     inline bool initial_name_char(char c)
       { return std::isalpha(c) or (c=='_'); }
     inline bool medial_name_char(char c)
-      { return initial_name_char(c) or (c=='-') or (c==':'); }
-
-    inline std::string read_name(std::istream &is) {
-      is >> std::ws;
-      char c=expect_char(
-               is,
-               [](char c) { return (c=='/') or initial_name_char(c); },
-               "final or alphabetic or underscore");;
-      std::string result{char(c)};
-      while (not is.eof()) {
-        c=char(is.peek());
-        if (std::isalnum(c) or (c=='_') or (c=='-') or (c==':'))
-          result+=char(is.get());
-        else
+      { return std::isalnum(c) or (c=='_') or (c=='-') or (c==':'); }
+    inline bool space_char(char c)
+      { return std::isspace(static_cast<unsigned char>(c)); }
+
+  }
+
+  // a pull ("SAX-like") reader: "next()" returns the next event of the
+  // input, which is read in large blocks into a buffer, and no tree is built;
+  // the name, attributes and text of an event are views into the buffer,
+  // valid only until the next call to "next()"; attribute values and text
+  // aren't decoded (see "implementation::xml_decode_text()"); whitespace
+  // between elements is skipped, as is leading whitespace in texts; an
+  // empty element ("<name .../>") yields a "start_element" event and an
+  // "end_element" event
+  class pull_reader_t {
+  public:
+    enum event_kind_t { start_element, end_element, text, end_of_input };
+    struct attribute_view_t {
+      std::string_view name, value;
+    };
+    struct event_t {
+      event_kind_t kind=end_of_input;
+      std::string_view name={}; // "start_element" and "end_element"
+      std::vector<attribute_view_t> attributes={}; // "start_element"
+      std::string_view text={}; // "text"
+    };
+
+    explicit pull_reader_t(std::istream &is,
+                           std::size_t block_size=std::size_t(1) << 16)
+      : is(is), block_size(block_size) { }
+
+    event_t const &next() {
+      if (pending_end) { // the end of an empty element
+        pending_end=false;
+        event.kind=end_element;
+        event.attributes.clear();
+        return event;
+      }
+      event.attributes.clear();
+      // skip whitespace
+      while (true) {
+        while ((pos<buffer.size()) and implementation::space_char(buffer[pos]))
+          ++pos;
+        if ((pos<buffer.size()) or not fill())
           break;
       }
-      return result;
+      if (pos==buffer.size()) {
+        event.kind=end_of_input;
+        return event;
+      }
+      if (buffer[pos] not_eq '<') {
+        auto end=find_end(false);
+        event.kind=text;
+        event.text=view(pos, end);
+        pos=end;
+        return event;
+      }
+      auto end=find_end(true);
+      if (end==buffer.size())
+        throw read_ended_unexpectedly("a tag ended unexpectedly");
+      read_tag(pos+1, end);
+      pos=end+1;
+      return event;
     }
 
-    inline std::string read_text(std::istream &is) {
-      is >> std::ws;
-      expect_char(is, '"');
-      std::string result;
-      auto c=0;
-      while ((not is.eof()) and ((c=is.get()) not_eq '"'))
-        result+=char(c);
-      return result;
+  private:
+    std::istream &is;
+    std::size_t const block_size;
+    std::string buffer;
+    std::size_t pos=0; // next character to read from "buffer"
+    event_t event;
+    bool pending_end=false;
+
+    std::string_view view(std::size_t begin, std::size_t end) const
+      { return std::string_view(buffer.data()+begin, end-begin); }
+
+    // move the unread characters to the beginning of the buffer, and append
+    // a new block; false if nothing could be read
+    bool fill() {
+      buffer.erase(0, pos);
+      pos=0;
+      auto size=buffer.size();
+      buffer.resize(size+block_size);
+      is.read(buffer.data()+size, std::streamsize(block_size));
+      buffer.resize(size+std::size_t(is.gcount()));
+      return buffer.size()>size;
     }
 
-    using recurse_f_t=std::function<bool (element_t::node_const_t)>;
-
-    inline content_t::root_t read_content(
-        std::istream &is,
-        action_t open={},
-        action_t close={},
-        recurse_f_t recurse={},
-        bool build_tree=true) {
-      is >> std::ws;
-      if (is.peek() not_eq '<') {
-        text_t text;
-        while ((not is.eof()) and (is.peek() not_eq '<'))
-          text+=char(is.get());
-        return std::make_shared<text_content_t>(xml_decode_text(text));
+    // the end of the token starting at "pos" (a tag, ending at '>', outside
+    // quotes, or a text, ending before '<'), reading as many blocks as
+    // needed; it's "buffer.size()" if the input ends before
+    std::size_t find_end(bool tag) {
+      bool quoted=false;
+      std::size_t i=pos+1;
+      while (true) {
+        for (; i<buffer.size(); ++i) {
+          char c=buffer[i];
+          if (not tag) {
+            if (c=='<')
+              return i;
+          }
+          else if (c=='"')
+            quoted=not quoted;
+          else if ((c=='>') and not quoted)
+            return i;
+        }
+        auto offset=i-pos;
+        if (not fill())
+          return buffer.size();
+        i=pos+offset;
       }
-      is.get(); // '<'
-      std::string name=read_name(is);
-      auto e=element_t::make_root(name);
+    }
 
-      if (name[0]=='/') {
-        // "closing-name"; not a real element, caught in the "while" loop below
-        expect_char(is >> std::ws, '>');
-        return e;
-      }
+    [[noreturn]] void unexpected(std::size_t i, std::string expected) const {
+      throw std::runtime_error(
+        "unexpected \""+std::string(view(i, i+1))+"\" in \""
+        +std::string(view(pos, i+1))+"\" while expecting "+expected);
+    }
+
+    std::size_t skip_space(std::size_t i, std::size_t end) const {
+      while ((i<end) and implementation::space_char(buffer[i]))
+        ++i;
+      return i;
+    }
 
-      is >> std::ws;
-      while (initial_name_char(char(is.peek()))) {
-        auto name=read_name(is);
-        is >> std::ws;
-        expect_char(is, '=');
-        is >> std::ws;
-        auto value=xml_decode_text(read_text(is));
-        e->append_attribute(name, value);
-        is >> std::ws;
+    std::size_t read_name(std::size_t i, std::size_t end,
+                          std::string_view &name) const {
+      if ((i==end) or not implementation::initial_name_char(buffer[i]))
+        unexpected(i, "alphabetic or underscore");
+      auto begin=i;
+      while ((i<end) and implementation::medial_name_char(buffer[i]))
+        ++i;
+      name=view(begin, i);
+      return i;
+    }
+
+    // read the tag in "[begin, end)" (i.e., without "<" and ">")
+    void read_tag(std::size_t begin, std::size_t end) {
+      auto i=skip_space(begin, end);
+      if ((i<end) and (buffer[i]=='/')) {
+        event.kind=end_element;
+        i=read_name(skip_space(i+1, end), end, event.name);
+        if (skip_space(i, end) not_eq end)
+          unexpected(i, "'>'");
+        return;
+      }
+      event.kind=start_element;
+      i=read_name(i, end, event.name);
+      while (true) {
+        i=skip_space(i, end);
+        if (i==end)
+          break;
+        if (buffer[i]=='/') {
+          if (skip_space(i+1, end) not_eq end)
+            unexpected(i+1, "'>'");
+          pending_end=true;
+          break;
+        }
+        attribute_view_t attribute;
+        i=skip_space(read_name(i, end, attribute.name), end);
+        if ((i==end) or (buffer[i] not_eq '='))
+          unexpected(i, "'='");
+        i=skip_space(i+1, end);
+        if ((i==end) or (buffer[i] not_eq '"'))
+          unexpected(i, "'\"'");
+        auto value_begin=++i;
+        while ((i<end) and (buffer[i] not_eq '"'))
+          ++i;
+        if (i==end)
+          unexpected(i, "'\"'");
+        attribute.value=view(value_begin, i++);
+        event.attributes.push_back(attribute);
       }
+    }
+  };
 
-      switch (is.get()) {
-      case '/': {
-        expect_char(is >> std::ws, '>');
+  namespace implementation {
 
-        if (open) open(e);
-        if (close) close(e);
+    inline element_t::root_t make_element(pull_reader_t::event_t const &e) {
+      auto element=element_t::make_root(name_t(e.name));
+      for (auto const &a: e.attributes)
+        element->append_attribute(name_t(a.name),
+                                  xml_decode_text(a.value));
+      return element;
+    }
 
-        return e;
-      } break;
-      case '>': {
-        bool recurse_this=not recurse or recurse(e);
-        if (recurse_this and open) open(e);
+    inline void check_closing(pull_reader_t::event_t const &closing,
+                              element_t const &e) {
+      if (closing.name not_eq e.name)
+        throw std::runtime_error(
+          "closing \""+name_t(closing.name)
+          +"\" doesn't match opening \""+e.name+"\"");
+    }
 
-        while (true) {
-          if (is.eof())
-            throw read_ended_unexpectedly(
-              "the \""+e->name+"\" element ended unexpectedly");
-          auto child=
-            recurse_this
-            ? read_content(is, open, close, recurse, build_tree)
-            : read_content(is);
-          auto child_as_element=std::dynamic_pointer_cast<element_t>(child);
-          if (child_as_element and (child_as_element->name[0]=='/')) {
-            if (child_as_element->name.substr(1) not_eq e->name)
-              std::runtime_error(
-                "closing \""+child_as_element->name
-                +"\" doesn't match opening \""+e->name+"\"");
-
-            if (not recurse_this and open) open(e);
-            if (close) close(e);
-
-            return e;
-          }
-          if (build_tree or not recurse_this)
-            e->adopt_child(child);
+    // read, as a tree, the contents of "e", whose "start_element" event has
+    // just been read, up to its "end_element" event
+    inline void read_contents(pull_reader_t &reader,
+                              element_t::root_t const &e) {
+      while (true) {
+        auto const &event=reader.next();
+        switch (event.kind) {
+        case pull_reader_t::start_element: {
+          auto child=make_element(event);
+          read_contents(reader, child);
+          e->adopt_child(child);
+        } break;
+        case pull_reader_t::text:
+          e->append_text(xml_decode_text(event.text));
+          break;
+        case pull_reader_t::end_element:
+          check_closing(event, *e);
+          return;
+        case pull_reader_t::end_of_input:
+        default:
+          throw read_ended_unexpectedly(
+            "the \""+e->name+"\" element ended unexpectedly");
         }
-      } break;
-      default:
-        break;
       }
-      return {}; // never reached
     }
 
   }
 
+  // read a whole element, as a tree
   inline element_t::root_t read_element(std::istream &is) {
-    auto e=
-      std::dynamic_pointer_cast<element_t>(implementation::read_content(is));
-    if (e or not is)
-      return e;
-    else
-      throw std::runtime_error("couldn't read an element");
+    pull_reader_t reader(is);
+    while (true) {
+      auto const &event=reader.next();
+      if (event.kind==pull_reader_t::end_of_input)
+        return {};
+      if (event.kind==pull_reader_t::start_element) {
+        auto e=implementation::make_element(event);
+        implementation::read_contents(reader, e);
+        return e;
+      }
+    }
   }
 
   inline element_t::node_const_t as_element(content_t::node_const_t c)
@@ -525,29 +680,354 @@ namespace kmsxml
       throw std::runtime_error("no action for \""+e->name+"\" element");
   }
 
-  inline content_t::root_t interpret_element(std::istream &is,
+  // read an element, giving its elements to the actions in "ocm" as they're
+  // read; elements whose traverse recurses are given to the actions without
+  // their contents (only with their attributes), "open" at their start, and
+  // "close" at their end; the other elements are read whole, as a (small)
+  // tree, and given to "open" and then "close" at their end
+  inline element_t::root_t interpret_element(std::istream &is,
                                              traverse_map_t const &ocm) {
     auto const get_traverse=
-      [&ocm] (element_t::node_const_t e) {
-        if (auto ei=ocm.find(e->name); ei not_eq ocm.end())
+      [&ocm] (name_t const &name) -> traverse_t const & {
+        if (auto ei=ocm.find(name); ei not_eq ocm.end())
           return ei->second;
         else
-          throw std::runtime_error("no action for \""+e->name+"\" element");
+          throw std::runtime_error("no action for \""+name+"\" element");
+      };
+    pull_reader_t reader(is);
+    element_t::root_t root;
+    std::vector<std::pair<element_t::root_t, traverse_t const *>> open;
+    do {
+      auto const &event=reader.next();
+      switch (event.kind) {
+      case pull_reader_t::start_element: {
+        auto e=implementation::make_element(event);
+        auto const &traverse=get_traverse(e->name);
+        if (not root)
+          root=e;
+        if (traverse.recurse) {
+          if (traverse.open)
+            traverse.open(e);
+          open.push_back({e, &traverse});
+        }
+        else {
+          implementation::read_contents(reader, e);
+          if (traverse.open)
+            traverse.open(e);
+          if (traverse.close)
+            traverse.close(e);
+        }
+      } break;
+      case pull_reader_t::end_element: {
+        if (open.empty())
+          throw std::runtime_error(
+            "closing \""+name_t(event.name)+"\" without opening");
+        auto [e, traverse]=open.back();
+        implementation::check_closing(event, *e);
+        if (traverse->close)
+          traverse->close(e);
+        open.pop_back();
+      } break;
+      case pull_reader_t::text: // text in recursed elements is ignored
+        break;
+      case pull_reader_t::end_of_input:
+      default:
+        if (not open.empty())
+          throw read_ended_unexpectedly(
+            "the \""+open.back().first->name+"\" element ended unexpectedly");
+        return root;
+      }
+    } while (not (root and open.empty()));
+    return root;
+  }
+
+
+  /// flat trees
+
+  // an alternative to "element_t" trees for reading: the strings of a
+  // "flat::document_t" go into an arena of large blocks (names are
+  // interned, so they're stored once, and compared as integers), and its
+  // nodes, attributes, and children lists are kept in contiguous arrays,
+  // indexed by integers; so, reading a tree takes a few allocations in
+  // total, instead of several per node; nodes are accessed through
+  // "flat::node_t" handles, which are valid as long as the document is
+  // alive and isn't moved
+  namespace flat {
+
+    using index_t=std::uint32_t;
+
+    class document_t;
+
+    class node_t {
+    public:
+      node_t()=default;
+      explicit operator bool() const { return document; }
+      bool is_element() const;
+      std::string_view name() const; // elements
+      std::string_view text() const; // text contents
+      std::size_t n_children() const;
+      node_t child(std::size_t i) const;
+      std::size_t n_attributes() const;
+      std::string_view attribute_name(std::size_t i) const;
+      std::string_view attribute_value(std::size_t i) const;
+    private:
+      node_t(document_t const *document, index_t index)
+        : document(document), index(index) { }
+      document_t const *document=nullptr;
+      index_t index=0;
+      friend class document_t;
+      friend std::string_view get_attribute_or_null(node_t,
+                                                    std::string_view,
+                                                    bool &);
+    };
+
+    class document_t {
+    public:
+      node_t root() const
+        { return nodes.empty() ? node_t() : node_t(this, 0); }
+    private:
+      static index_t constexpr no_name=index_t(-1); // text contents
+
+      struct node_record_t {
+        index_t name;
+        index_t first_attribute=0, n_attributes=0;
+        index_t first_child=0, n_children=0;
+        std::string_view text={};
       };
-    return implementation::read_content(
-      is,
-      [&ocm, &get_traverse] (element_t::node_const_t e) {
-        if (auto t=get_traverse(e); t.open)
-          t.open(e);
-      },
-      [&ocm, &get_traverse] (element_t::node_const_t e) {
-        if (auto t=get_traverse(e); t.close)
-          t.close(e);
-      },
-      [&ocm, &get_traverse] (element_t::node_const_t e) {
-        return get_traverse(e).recurse;
-      },
-      false);
+      struct attribute_record_t {
+        index_t name;
+        std::string_view value;
+      };
+
+      // a bump allocator for the strings
+      class arena_t {
+      public:
+        char *allocate(std::size_t size) {
+          if (size>available) {
+            auto block_size=std::max(size, min_block_size);
+            blocks.push_back(std::make_unique<char[]>(block_size));
+            next=blocks.back().get();
+            available=block_size;
+          }
+          auto result=next;
+          next+=size;
+          available-=size;
+          return result;
+        }
+      private:
+        static std::size_t constexpr min_block_size=std::size_t(1) << 16;
+        std::vector<std::unique_ptr<char[]>> blocks;
+        char *next=nullptr;
+        std::size_t available=0;
+      };
+
+      arena_t arena;
+      std::vector<node_record_t> nodes;
+      std::vector<attribute_record_t> attributes;
+      std::vector<index_t> children;
+      std::vector<std::string_view> names;
+      std::unordered_map<std::string_view, index_t> name_ids;
+
+      std::string_view store(std::string_view s) {
+        auto p=arena.allocate(s.size());
+        std::copy(s.begin(), s.end(), p);
+        return {p, s.size()};
+      }
+      std::string_view store_decoded(std::string_view s) {
+        auto p=arena.allocate(s.size());
+        return {p, implementation::xml_decode_text_to(s, p)};
+      }
+      index_t intern(std::string_view name) {
+        if (auto i=name_ids.find(name); i not_eq name_ids.end())
+          return i->second;
+        auto stored=store(name);
+        auto id=index_t(names.size());
+        names.push_back(stored);
+        name_ids.emplace(stored, id);
+        return id;
+      }
+      index_t find_name(std::string_view name) const {
+        auto i=name_ids.find(name);
+        return (i==name_ids.end()) ? no_name : i->second;
+      }
+
+      friend class node_t;
+      friend document_t read_document(std::istream &);
+      friend std::string_view get_attribute_or_null(node_t,
+                                                    std::string_view,
+                                                    bool &);
+    };
+
+    inline bool node_t::is_element() const
+      { return document->nodes[index].name not_eq document_t::no_name; }
+    inline std::string_view node_t::name() const
+      { return document->names[document->nodes[index].name]; }
+    inline std::string_view node_t::text() const
+      { return document->nodes[index].text; }
+    inline std::size_t node_t::n_children() const
+      { return document->nodes[index].n_children; }
+    inline node_t node_t::child(std::size_t i) const {
+      return {document,
+              document->children[document->nodes[index].first_child+i]};
+    }
+    inline std::size_t node_t::n_attributes() const
+      { return document->nodes[index].n_attributes; }
+    inline std::string_view node_t::attribute_name(std::size_t i) const {
+      auto const &a=
+        document->attributes[document->nodes[index].first_attribute+i];
+      return document->names[a.name];
+    }
+    inline std::string_view node_t::attribute_value(std::size_t i) const {
+      return
+        document->attributes[document->nodes[index].first_attribute+i].value;
+    }
+
+    // read a whole element; the document is empty if there is none
+    inline document_t read_document(std::istream &is) {
+      document_t d;
+      pull_reader_t reader(is);
+      // the open elements, and the children of each of them so far (kept
+      // by depth, so that their capacity is reused)
+      std::vector<index_t> open;
+      std::vector<std::vector<index_t>> open_children;
+      auto add_node=
+        [&d, &open, &open_children](document_t::node_record_t node) {
+          auto index=index_t(d.nodes.size());
+          d.nodes.push_back(node);
+          if (not open.empty())
+            open_children[open.size()-1].push_back(index);
+          return index;
+        };
+      while (true) {
+        auto const &event=reader.next();
+        switch (event.kind) {
+        case pull_reader_t::start_element: {
+          document_t::node_record_t node{d.intern(event.name)};
+          node.first_attribute=index_t(d.attributes.size());
+          node.n_attributes=index_t(event.attributes.size());
+          for (auto const &a: event.attributes)
+            d.attributes.push_back({d.intern(a.name),
+                                    d.store_decoded(a.value)});
+          open.push_back(add_node(node));
+          if (open_children.size()<open.size())
+            open_children.emplace_back();
+          open_children[open.size()-1].clear();
+        } break;
+        case pull_reader_t::text:
+          if (not open.empty())
+            add_node({document_t::no_name, 0, 0, 0, 0,
+                      d.store_decoded(event.text)});
+          break;
+        case pull_reader_t::end_element: {
+          if (open.empty())
+            throw std::runtime_error(
+              "closing \""+name_t(event.name)+"\" without opening");
+          auto &node=d.nodes[open.back()];
+          if (event.name not_eq d.names[node.name])
+            throw std::runtime_error(
+              "closing \""+name_t(event.name)
+              +"\" doesn't match opening \""+name_t(d.names[node.name])
+              +"\"");
+          auto const &node_children=open_children[open.size()-1];
+          node.first_child=index_t(d.children.size());
+          node.n_children=index_t(node_children.size());
+          d.children.insert(d.children.end(),
+                            node_children.begin(), node_children.end());
+          open.pop_back();
+          if (open.empty())
+            return d;
+        } break;
+        case pull_reader_t::end_of_input:
+        default:
+          if (not open.empty())
+            throw read_ended_unexpectedly(
+              "the \""+name_t(d.names[d.nodes[open.back()].name])
+              +"\" element ended unexpectedly");
+          return d;
+        }
+      }
+    }
+
+    // the same queries as for "element_t" trees; the attribute lookup
+    // compares interned names
+
+    inline std::string_view get_attribute_or_null(node_t e,
+                                                  std::string_view name,
+                                                  bool &found) {
+      auto const &d=*e.document;
+      auto id=d.find_name(name);
+      auto const &node=d.nodes[e.index];
+      for (index_t i=0; (id not_eq document_t::no_name)
+                          and (i<node.n_attributes); ++i) {
+        auto const &a=d.attributes[node.first_attribute+i];
+        if (a.name==id) {
+          found=true;
+          return a.value;
+        }
+      }
+      found=false;
+      return {};
+    }
+
+    inline bool has_attribute(node_t e, std::string_view name) {
+      bool found;
+      get_attribute_or_null(e, name, found);
+      return found;
+    }
+
+    inline std::string_view get_attribute(node_t e, std::string_view name) {
+      bool found;
+      auto value=get_attribute_or_null(e, name, found);
+      if (not found)
+        throw std::runtime_error("no \""+name_t(name)+"\" attribute in \""
+                                 +name_t(e.name())+"\" element");
+      return value;
+    }
+
+    inline text_t get_text(node_t e) {
+      text_t result;
+      for (std::size_t i=0; i<e.n_children(); ++i)
+        if (auto c=e.child(i); not c.is_element())
+          result+=c.text();
+      return result;
+    }
+
+    inline node_t get_child_or_null(node_t e, std::string_view name) {
+      for (std::size_t i=0; i<e.n_children(); ++i)
+        if (auto c=e.child(i); c.is_element() and (c.name()==name))
+          return c;
+      return {};
+    }
+
+    inline node_t get_child(node_t e, std::string_view name) {
+      if (auto c=get_child_or_null(e, name))
+        return c;
+      else
+        throw std::runtime_error("no \""+name_t(name)+"\" child in \""
+                                 +name_t(e.name())+"\" element");
+    }
+
+    // the same format as "content_t::print_tree()"
+    inline void print_tree(std::ostream &os, node_t e, size_t indent=0) {
+      os << implementation::tree_indent_text(indent);
+      if (not e.is_element()) {
+        os << "\"" << e.text() << "\"" << std::endl;
+        return;
+      }
+      os << e.name();
+      for (std::size_t i=0; i<e.n_attributes(); ++i)
+        os << " " << e.attribute_name(i)
+           << "=\"" << e.attribute_value(i) << "\"";
+      os << std::endl;
+      for (std::size_t i=0; i<e.n_children(); ++i)
+        print_tree(os, e.child(i), indent+1);
+    }
+    inline std::string print_tree(node_t e) {
+      std::ostringstream oss;
+      print_tree(oss, e);
+      return oss.str();
+    }
+
   }
 }
 
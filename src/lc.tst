@@ -2,43 +2,51 @@ TOP_TEST_NODE          top_test_node
 DEFINE_TOP_TEST_NODE   define_top_test_node
 DEFINE_TEST_NODE       define_test_node
 
-DEFINE_TOP_TEST define_top_test
-DEFINE_TEST     define_test
-WITH_FIXTURE    with_fixture
-VISIBLE_FIXTURE visible_fixture
-FIXTURE_ARGS    fixture_args
+DEFINE_TOP_TEST      define_top_test
+DEFINE_TEST          define_test
+DEFINE_TOP_BENCHMARK define_top_benchmark
+DEFINE_BENCHMARK     define_benchmark
+WITH_FIXTURE         with_fixture
+VISIBLE_FIXTURE      visible_fixture
+FIXTURE_ARGS         fixture_args
 
 TOUT        tout
 TFOS        tfos
 
-DECLARE              declare
-PERFORM              perform
-FAKE_DECLARE         fake_declare
-FAKE_PERFORM         fake_perform
-FIXTURE_MEMBER       fixture_member
-FIXTURE_INIT         fixture_init
-WITH_DATA            with_data
-WITH_MULTILINE_DATA  with_multiline_data
-CHECK_TRY            check_try
-CATCH                _catch
-SHOW_VALUE           show_value
-IN_SCOPE             in_scope
-WITH_DECLARE         with_declare
+DECLARE                      declare
+PERFORM                      perform
+FAKE_DECLARE                 fake_declare
+FAKE_PERFORM                 fake_perform
+FIXTURE_MEMBER               fixture_member
+FIXTURE_INIT                 fixture_init
+WITH_DATA                    with_data
+WITH_MULTILINE_DATA          with_multiline_data
+PARALLEL_WITH_DATA           parallel_with_data
+PARALLEL_WITH_MULTILINE_DATA parallel_with_multiline_data
+CHECK_TRY                    check_try
+CATCH                        _catch
+SHOW_VALUE                   show_value
+IN_SCOPE                     in_scope
+WITH_DECLARE                 with_declare
+BENCHMARK                    benchmark
 
 DEFINE_APPROX_EPSILON define_approx_epsilon
 SET_APPROX_EPSILON    set_approx_epsilon
 SHOW_APPROX_EPSILON   show_approx_epsilon
 
-CHECK      check
-PROVIDED   provided
-TRUE       _true
-FALSE      _false
-EQUAL      _equal
-NOT_EQUAL  _not_equal
-APPROX     _approx
-NOT_APPROX _not_approx
-WITH_TOL   _with_tol
-SHOW       _show
+CHECK         check
+PROVIDED      provided
+TRUE          _true
+FALSE         _false
+EQUAL         _equal
+NOT_EQUAL     _not_equal
+APPROX        _approx
+NOT_APPROX    _not_approx
+WITH_TOL      _with_tol
+SHOW          _show
+CHECK_TIME    check_time
+BELOW         _below
+NO_REGRESSION _no_regression
 
 MOCK_METHOD     mock_method
 WRAP_METHOD     wrap_method
@@ -16,8 +16,21 @@
 //     along with Testudo.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "testudo.h"
+#include "testudo_format_record.h"
+#include "testudo_fork.h"
 #include "glob_pattern.h"
+#include "crc.h"
 #include <list>
+#include <vector>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <tuple>
+#include <unordered_map>
+#include <mutex>
+#include <iostream>
 #include <cassert>
 
 namespace testudo___implementation {
@@ -41,6 +54,9 @@ namespace testudo___implementation {
     if (auto it=children.find(name); it==children.end()) {
       sptr child(new TestNode(location, pptr(this), name));
       children[name]=child;
+      invalidate_index();
+      if (auto const &observer=registration_observer())
+        observer(*child);
       return child;
     }
     else
@@ -51,6 +67,10 @@ namespace testudo___implementation {
     if (set_title_and_bucket)
       throw std::runtime_error("test node \""+full_name+"\" set twice");
     set_title_and_bucket=true;
+    // the order of the children of the parent may change
+    invalidate_index();
+    if (auto const &observer=registration_observer())
+      observer(*this);
   }
 
   void TestNode::set(title_t set_title, priority_t set_priority) {
@@ -66,12 +86,107 @@ namespace testudo___implementation {
     parent->declaration_order_children.push_back(name);
   }
 
+  TestNode::registration_observer_t &TestNode::registration_observer() {
+    static registration_observer_t result;
+    return result;
+  }
+
   TestNode::sptr TestNode::root_node() {
     static sptr result(new TestNode({}, nullptr, "/"));
     return result;
   }
 
+  namespace {
+
+    // whether the latest index is up to date; it's rebuilt, and handed out,
+    // under the mutex
+    atomic<bool> index_valid{false};
+    mutex index_mutex;
+
+  }
+
+  struct TestNode::index_t {
+    // breadth-first, so that the ordered children of each node are
+    // contiguous
+    vector<sptr> nodes;
+    // the children of "nodes[i]" are "nodes[children[i].first]" up to, but
+    // not including, "nodes[children[i].second]"
+    vector<pair<size_t, size_t>> children;
+    unordered_map<name_t, size_t> by_full_name;
+    // the position of each node in "nodes"; it belongs to the index, rather
+    // than to the node, since runs may still be using older indices
+    unordered_map<TestNode const *, size_t> positions;
+
+    size_t position(TestNode const &node) const
+      { return positions.at(&node); }
+
+    // in the order described for "ordered_children()"
+    static void add_ordered_children(TestNode const &node,
+                                     vector<sptr> &nodes) {
+      // declaration-ordered children
+      for (auto const &child_name: node.declaration_order_children) {
+        sptr child=node.children.at(child_name);
+        assert(child);
+        assert(child->set_declaration_order);
+        nodes.push_back(child);
+      }
+      // prioritised children: first by priority, then alphabetically (the
+      // children map is already in alphabetical order)
+      auto first_prioritised=nodes.size();
+      for (auto const &[name, child]: node.children) {
+        assert(child);
+        if (not child->set_declaration_order)
+          nodes.push_back(child);
+      }
+      stable_sort(nodes.begin()+static_cast<ptrdiff_t>(first_prioritised),
+                  nodes.end(),
+                  [](sptr const &c1, sptr const &c2)
+                    { return c1->priority<c2->priority; });
+    }
+
+    void build() {
+      nodes.assign(1, root_node());
+      children.clear();
+      by_full_name.clear();
+      positions.clear();
+      for (size_t i=0; i<nodes.size(); ++i) {
+        // a copy, since "nodes" grows
+        auto node=nodes[i];
+        positions.emplace(node.get(), i);
+        if (i>0)
+          by_full_name.emplace(node->full_name, i);
+        auto first_child=nodes.size();
+        add_ordered_children(*node, nodes);
+        children.emplace_back(first_child, nodes.size());
+      }
+    }
+  };
+
+  TestNode::index_p TestNode::index() {
+    static index_p latest;
+    lock_guard<mutex> lock(index_mutex);
+    if (not index_valid.load()) {
+      // a new one, since runs may still be using the previous one
+      auto built=make_shared<index_t>();
+      built->build();
+      latest=built;
+      index_valid.store(true);
+    }
+    return latest;
+  }
+
+  void TestNode::invalidate_index()
+    { index_valid.store(false); }
+
   TestNode::sptr TestNode::get_node(name_t const &full_name) {
+    // while test libraries are being loaded, the index is out of date, and
+    // the tree is walked instead
+    if (index_valid.load()) {
+      auto i=index();
+      if (auto found=i->by_full_name.find(full_name);
+          found not_eq i->by_full_name.end())
+        return i->nodes[found->second];
+    }
     if (full_name.empty())
       return root_node();
     else {
@@ -86,138 +201,509 @@ namespace testudo___implementation {
     }
   }
 
+  TestNode::sptr TestNode::find_node(name_t const &full_name) {
+    auto root=root_node();
+    if (full_name==root->full_name)
+      return root;
+    auto i=index();
+    auto found=i->by_full_name.find(full_name);
+    return (found==i->by_full_name.end()) ? nullptr : i->nodes[found->second];
+  }
+
+  class include_trie_t {
+  public:
+    using position_t=size_t;
+    // the whole subtree is included
+    static position_t const all=position_t(-1);
+    // nothing in the subtree is included
+    static position_t const none=position_t(-2);
+
+    explicit include_trie_t(list<name_t> const &include) {
+      if (include.empty())
+        return;
+      nodes.emplace_back();
+      for (auto const &i: include) {
+        position_t position=0;
+        size_t begin=0;
+        while (true) {
+          auto dot=i.find('.', begin);
+          auto part=i.substr(begin, dot-begin);
+          auto [found, inserted]=
+            nodes[position].children.emplace(part, nodes.size());
+          if (inserted)
+            nodes.emplace_back();
+          position=found->second;
+          if (dot==string::npos)
+            break;
+          begin=dot+1;
+        }
+        nodes[position].whole=true;
+      }
+    }
+
+    // where to start from, for the node "TestNode::test()" is called on
+    position_t start() const { return nodes.empty() ? all : 0; }
+    // where to go on from, for a child named "name" of a node at "position"
+    position_t child(position_t position, name_t const &name) const {
+      if ((position==all) or (position==none))
+        return position;
+      auto const &children=nodes[position].children;
+      auto found=children.find(name);
+      if (found==children.end())
+        return none;
+      return nodes[found->second].whole ? all : found->second;
+    }
+
+  private:
+    struct node_t {
+      bool whole=false;
+      map<name_t, position_t> children;
+    };
+    vector<node_t> nodes;
+  };
+
+  struct name_filter_t {
+    glob::pattern_set_t const patterns;
+    // for each node in the index, by position, whether its subtree has some
+    // matching test function (-1 until worked out)
+    mutable vector<signed char> some_matching;
+  };
+
+  namespace {
+
+    // run all tasks on "jobs" threads; each thread takes the next pending
+    // task as soon as it's done with the previous one, so that a long task
+    // doesn't hold up the rest of the tasks; once there are no more tasks to
+    // take, each thread gives itself back to "job_budget", for the parallel
+    // "with()" loops of the tasks still running
+    void run_in_parallel(vector<function<void ()>> const &tasks,
+                         unsigned jobs, JobBudget &job_budget) {
+      atomic<size_t> next_task{0};
+      auto worker=
+        [&]() {
+          for (size_t i=next_task++; i<tasks.size(); i=next_task++)
+            tasks[i]();
+          job_budget.give_back(1);
+        };
+      vector<thread> threads;
+      for (unsigned j=1; j<jobs; ++j)
+        threads.emplace_back(worker);
+      worker(); // the calling thread is a worker too
+      for (auto &t: threads)
+        t.join();
+    }
+
+  }
+
+  namespace {
+
+    using duration_f_t=function<double (TestNode const *)>;
+
+    // the predicted duration of a test function, according to "durations";
+    // test functions without a recorded duration are assumed to last the
+    // average; without "durations", all test functions last the same
+    duration_f_t duration_predictor(durations_t const *durations) {
+      if ((not durations) or durations->empty())
+        return [](TestNode const *) { return 1.; };
+      double total=0.;
+      for (auto const &[name, duration]: *durations)
+        total+=duration;
+      double average=total/static_cast<double>(durations->size());
+      return
+        [durations, average](TestNode const *node) {
+          auto found=durations->find(node->full_name);
+          return (found==durations->end()) ? average : found->second;
+        };
+    }
+
+    // the time it takes to run tasks on "jobs" workers, taking them in order
+    // as workers become idle
+    double makespan(vector<double> const &durations, unsigned jobs) {
+      vector<double> workers(max(jobs, 1u), 0.);
+      for (auto duration: durations)
+        *min_element(workers.begin(), workers.end())+=duration;
+      return *max_element(workers.begin(), workers.end());
+    }
+
+    double seconds_since(chrono::steady_clock::time_point start) {
+      return
+        chrono::duration<double>(chrono::steady_clock::now()-start).count();
+    }
+
+    // split the test functions in "n_shards" parts, balanced by duration, and
+    // return the "shard"-th one (from 1); the test functions are dealt, from
+    // longest to shortest, and, for equal durations, in the order of the
+    // CRC-64 of their full names, to the least loaded shard, so the split
+    // doesn't depend on the order in which test libraries are loaded
+    vector<TestNode const *>
+    shard_test_functions(vector<TestNode const *> nodes,
+                         unsigned shard, unsigned n_shards,
+                         duration_f_t const &duration) {
+      using cyclic_redundancy_check::crc64;
+      // a fixed cost per test function, so that shards are balanced by
+      // number too, when durations are negligible
+      double const overhead=1e-4;
+      sort(nodes.begin(), nodes.end(),
+           [&duration](TestNode const *n1, TestNode const *n2) {
+             return
+               make_tuple(-duration(n1), crc64(n1->full_name), n1->full_name)
+               < make_tuple(-duration(n2), crc64(n2->full_name),
+                            n2->full_name);
+           });
+      vector<double> loads(n_shards, 0.);
+      vector<TestNode const *> result;
+      for (auto node: nodes) {
+        auto least_loaded=min_element(loads.begin(), loads.end());
+        *least_loaded+=duration(node)+overhead;
+        if (static_cast<unsigned>(least_loaded-loads.begin())+1==shard)
+          result.push_back(node);
+      }
+      return result;
+    }
+
+    // add to "selection" the test functions of "nodes" (or just the nodes,
+    // if "own" is false)
+    void add_to_selection(TestNode::selection_t &selection,
+                          vector<TestNode const *> const &nodes,
+                          bool own=true) {
+      for (auto node: nodes) {
+        if (own)
+          selection[node]=true;
+        else
+          selection.emplace(node, false);
+        for (auto ancestor=node->parent;
+             ancestor and selection.emplace(ancestor, false).second;
+             ancestor=ancestor->parent)
+          ;
+      }
+    }
+
+  }
+
   TestStats
   TestNode::test(test_format_p test_format,
                  list<name_t> include,
-                 list<string> glob) const {
+                 list<string> glob,
+                 test_run_options_t const &options) const {
+    TestStats test_stats;
+    bool const sequential=(options.jobs<=1) and not options.isolated;
+    bool const sharded=(options.n_shards>1);
+    auto predicted_duration=duration_predictor(options.durations);
+    vector<TestNode const *> nodes, empty_leaves;
+    auto const tree_index=index();
+    include_trie_t const include_trie(include);
+    name_filter_t const name_filter{
+      glob::pattern_set_t(glob),
+      vector<signed char>(tree_index->nodes.size(), -1)};
+    if (sharded or not sequential or options.durations)
+      collect_test_functions(nodes, *tree_index, tree_index->position(*this),
+                             include_trie, include_trie.start(), name_filter,
+                             &empty_leaves);
+    selection_t selection;
+    if (sharded) {
+      nodes=shard_test_functions(nodes, options.shard, options.n_shards,
+                                 predicted_duration);
+      add_to_selection(selection, nodes);
+      // nodes without any test function are output by the first shard, so
+      // that all the shards together output the whole tree
+      if (options.shard==1)
+        add_to_selection(selection, empty_leaves, false);
+    }
+    selection_t const *run_selection=sharded ? &selection : nullptr;
+    // longest first (the sort is stable, so, without durations, the order
+    // is that of a sequential run)
+    stable_sort(nodes.begin(), nodes.end(),
+                [&predicted_duration](TestNode const *n1,
+                                      TestNode const *n2)
+                  { return predicted_duration(n1)>predicted_duration(n2); });
+    // the threads of the run: "jobs", or, if there's just one, every
+    // hardware thread, for parallel "with()" loops to use
+    unsigned const all_jobs=
+      (options.jobs>1)
+      ? options.jobs : max(thread::hardware_concurrency(), 1u);
+    map<TestNode const *, double> measured_durations;
+    auto start=chrono::steady_clock::now();
+    if (sequential)
+      run_tests({test_format, {}, test_stats, {},
+                 make_shared<JobBudget>(all_jobs-1)},
+                *tree_index, tree_index->position(*this),
+                include_trie, include_trie.start(), name_filter,
+                [&measured_durations](TestNode const &node,
+                                      test_management_t test_management) {
+                  auto test_start=chrono::steady_clock::now();
+                  node.run_test_function(test_management);
+                  measured_durations[&node]=seconds_since(test_start);
+                },
+                run_selection);
+    else {
+      // first, run every selected test function, concurrently or in worker
+      // processes, each one on its own record and with its own stats
+      struct result_t {
+        shared_ptr<TestFormatRecord> record=make_shared<TestFormatRecord>();
+        TestStats stats;
+      };
+      vector<result_t> results(nodes.size());
+      map<TestNode const *, result_t const *> node_results;
+      // benchmarks are left out, to be run afterwards, one by one, in this
+      // process, so that they don't compete with anything for the CPU
+      vector<size_t> concurrent, benchmarks;
+      vector<isolated_test_f_t> tests;
+      vector<test_management_t> test_managements;
+      for (size_t i=0; i<nodes.size(); ++i) {
+        node_results[nodes[i]]=&results[i];
+        (nodes[i]->is_benchmark() ? benchmarks : concurrent).push_back(i);
+      }
+      // the threads running test functions take the whole budget, but give
+      // themselves back as they run out of test functions; worker processes
+      // have a budget of their own, which is empty, unless there's just one
+      auto job_budget=make_shared<JobBudget>(0);
+      auto test_job_budget=
+        options.isolated
+        ? make_shared<JobBudget>((options.jobs>1) ? 0 : all_jobs-1)
+        : job_budget;
+      for (auto i: concurrent) {
+        tests.push_back(
+          [node=nodes[i], test_job_budget](test_management_t test_management) {
+            test_management.job_budget=test_job_budget;
+            node->run_test_function(test_management);
+          });
+        test_managements.push_back({results[i].record, {}, results[i].stats});
+      }
+      vector<double> durations(tests.size());
+      if (options.isolated)
+        run_in_processes(tests, test_managements, options.jobs,
+                         options.timeout, durations);
+      else {
+        vector<function<void ()>> tasks;
+        for (size_t i=0; i<tests.size(); ++i)
+          tasks.push_back(
+            [&, i]() {
+              auto test_start=chrono::steady_clock::now();
+              tests[i](test_managements[i]);
+              durations[i]=seconds_since(test_start);
+            });
+        run_in_parallel(tasks, options.jobs, *job_budget);
+      }
+      for (size_t i=0; i<concurrent.size(); ++i)
+        measured_durations[nodes[concurrent[i]]]=durations[i];
+      // benchmarks run alone, on this thread
+      job_budget=make_shared<JobBudget>(all_jobs-1);
+      for (auto i: benchmarks) {
+        auto test_start=chrono::steady_clock::now();
+        nodes[i]->run_test_function({results[i].record, {},
+                                     results[i].stats, {}, job_budget});
+        measured_durations[nodes[i]]=seconds_since(test_start);
+      }
+      // then, traverse the tree as a sequential run would, but replaying the
+      // records instead of running the test functions
+      run_tests({test_format, {}, test_stats},
+                *tree_index, tree_index->position(*this),
+                include_trie, include_trie.start(), name_filter,
+                [&node_results](TestNode const &node,
+                                test_management_t test_management) {
+                  auto const &result=*node_results.at(&node);
+                  result.record->replay(*test_management.format);
+                  test_management.stats+=result.stats;
+                },
+                run_selection);
+    }
+    if (options.run_makespan) {
+      options.run_makespan->actual=seconds_since(start);
+      options.run_makespan->predicted.reset();
+      if (options.durations and not options.durations->empty()) {
+        vector<double> predicted_durations;
+        for (auto node: nodes)
+          predicted_durations.push_back(predicted_duration(node));
+        options.run_makespan->predicted=
+          makespan(predicted_durations, sequential ? 1 : options.jobs);
+      }
+    }
+    if (options.durations)
+      for (auto const &[node, duration]: measured_durations)
+        (*options.durations)[node->full_name]=duration;
+    test_format->print_test_readout();
+    return test_stats;
+  }
+
+  TestStats TestNode::replay(test_format_p test_format,
+                             selection_t const &selection,
+                             run_test_f_t const &replay_test) const {
     TestStats test_stats;
-    run_tests({test_format, {}, test_stats}, include, glob);
+    auto const tree_index=index();
+    include_trie_t const include_all({});
+    name_filter_t const match_all{glob::pattern_set_t({}), {}};
+    run_tests({test_format, {}, test_stats},
+              *tree_index, tree_index->position(*this),
+              include_all, include_all.start(), match_all,
+              replay_test, &selection);
     test_format->print_test_readout();
     return test_stats;
   }
 
   list<TestNode::sptr> TestNode::ordered_children() const {
-    list<sptr> ordered_children;
-
-    // declaration-ordered children
-    for (auto const &child_name: declaration_order_children) {
-      sptr child=children.at(child_name);
-      assert(child);
-      assert(child->set_declaration_order);
-      ordered_children.push_back(child);
-    }
-
-    // prioritised children: first by priority, then alphabetically
-    map<priority_t, map<name_t, sptr>> sorting;
-    for (auto const &[name, child]: children) {
-      assert(child);
-      if (not child->set_declaration_order)
-        sorting[child->priority][child->name]=child;
-    }
-    for (auto const &[priority, priority_map]: sorting)
-      for (auto const &[name, child]: priority_map)
-        ordered_children.push_back(child);
-
-    return ordered_children;
+    auto i=index();
+    auto [first, last]=i->children[i->position(*this)];
+    return {i->nodes.begin()+static_cast<ptrdiff_t>(first),
+            i->nodes.begin()+static_cast<ptrdiff_t>(last)};
   }
 
   namespace {
 
-    bool matches_at_least_one_or_empty(name_t name, list<name_t> include) {
-      // when "include" is empty, all tests are run, so true
-      if (include.empty())
-        return true;
-      // otherwise, this child is run only if it's one of the included nodes,
-      auto name_dot=name+'.';
-      for (auto i: include)
-        // i.e., either a matching leaf, or a node that matches the beginning
-        // of an included node
-        if ((name==i) or (name_dot==i.substr(0, name_dot.length())))
-          return true;
-      return false;
-    }
-
-    // if "include" is empty, the result must be empty; if "name" only matches
-    // exactly (without the trailing '.'), the result must be empty, meaning
-    // "all children"; otherwise, take elements matching the name with a
-    // trailing '.', and trim them
-    list<name_t> trim_include(name_t name, list<name_t> include) {
-      list<name_t> result;
-      auto name_dot=name+'.';
-      for (auto i: include)
-        if (name==i)
-          return {};
-        else if (name_dot==i.substr(0, name_dot.length()))
-          result.push_back(i.substr(name_dot.length()));
-      return result;
+    bool is_selected(TestNode::selection_t const &selection,
+                     TestNode const *node) {
+      auto found=selection.find(node);
+      return (found not_eq selection.end()) and found->second;
     }
 
   }
 
-  bool TestNode::matching_name(list<string> glob) const {
-    if (glob.empty()) // no globs -> always matching
+  bool TestNode::matching_name(name_filter_t const &glob) const {
+    if (glob.patterns.empty()) // no globs -> always matching
       return true;
     else
-      for (auto g: glob)
-        if (glob::matches(full_name, g))
-          return true;
-    return false;
+      return glob.patterns.matches(full_name);
   }
 
-  bool TestNode::some_matching_function(list<string> glob) const {
-    if (glob.empty()) // no globs -> run all
-      return true;
-    else if (test_f and matching_name(glob))
+  bool TestNode::some_matching_function(name_filter_t const &glob,
+                                        index_t const &index,
+                                        size_t position) const {
+    if (glob.patterns.empty()) // no globs -> run all
       return true;
-    else
-      for (auto const &[name, child]: children)
-        if (child->some_matching_function(glob))
-          return true;
-    return false;
+    auto &some_matching=glob.some_matching[position];
+    if (some_matching<0) {
+      bool result=test_f and matching_name(glob);
+      auto [first_child, last_child]=index.children[position];
+      for (auto c=first_child; (not result) and (c<last_child); ++c)
+        result=index.nodes[c]->some_matching_function(glob, index, c);
+      some_matching=result;
+    }
+    return some_matching;
   }
 
   void TestNode::run_tests(test_management_t test_management,
-                           list<name_t> include,
-                           list<string> glob) const {
+                           index_t const &index, size_t position,
+                           include_trie_t const &include,
+                           size_t include_position,
+                           name_filter_t const &glob,
+                           run_test_f_t const &run_test,
+                           selection_t const *selection) const {
     test_management.format->set_title_location(location);
     test_management.format->output_title(full_name, title);
+    // the span of the children and the own test function
+    TestFormat::timing_t timing;
 
     // run the children's tests in order
-    for (auto const &child: ordered_children())
-      if (matches_at_least_one_or_empty(child->name, include)
-          and child->some_matching_function(glob)) {
+    auto [first_child, last_child]=index.children[position];
+    for (auto c=first_child; c<last_child; ++c) {
+      auto const &child=index.nodes[c];
+      if (auto child_include=include.child(include_position, child->name);
+          (child_include not_eq include_trie_t::none)
+          and child->some_matching_function(glob, index, c)
+          and ((not selection) or selection->count(child.get()))) {
         TestStats child_test_stats;
-        child->run_tests({test_management.format, {}, child_test_stats},
-                         trim_include(child->name, include),
-                         glob);
+        child->run_tests({test_management.format, {}, child_test_stats,
+                          {}, test_management.job_budget},
+                         index, c, include, child_include,
+                         glob, run_test, selection);
         test_management.stats+=child_test_stats;
+        timing|=test_management.format->get_timing();
       }
+    }
 
     // run own test function if set
-    if (test_f and matching_name(glob)) {
-      try {
-        value_format_ostream_t test_vfos=make_shared<ValueFormatOStream>();
-        test_vfos->fmt_os.copyfmt(default_fmt_os);
-        test_f({test_management.format, test_vfos, test_management.stats});
-      }
-      catch (exception const &excp) {
-        test_management.format->uncaught_exception(excp.what());
-        test_management.stats.unexpected_error();
-      }
-      catch (char const *mess) {
-        test_management.format->uncaught_exception(mess);
-        test_management.stats.unexpected_error();
-      }
-      catch (...) {
-        test_management.format->uncaught_exception("<unknown error type>");
-        test_management.stats.unexpected_error();
-      }
+    if (test_f and matching_name(glob)
+        and ((not selection) or is_selected(*selection, this))) {
+      test_management.format->start_test_function();
+      run_test(*this, test_management);
+      timing|=test_management.format->get_timing();
     }
 
+    test_management.format->set_timing(timing);
     test_management.format
       ->produce_summary(full_name, test_management.stats);
   }
 
+  void TestNode::run_test_function(test_management_t test_management) const {
+    // the fixture, if any, fills in its own timing as the test function runs
+    test_management.format->set_timing({monotonic_time()});
+    try {
+      value_format_ostream_t test_vfos=make_shared<ValueFormatOStream>();
+      test_vfos->fmt_os.copyfmt(default_fmt_os);
+      test_f({test_management.format, test_vfos, test_management.stats,
+              full_name, test_management.job_budget});
+    }
+    catch (exception const &excp) {
+      test_management.format->uncaught_exception(excp.what());
+      test_management.stats.unexpected_error();
+    }
+    catch (char const *mess) {
+      test_management.format->uncaught_exception(mess);
+      test_management.stats.unexpected_error();
+    }
+    catch (...) {
+      test_management.format->uncaught_exception("<unknown error type>");
+      test_management.stats.unexpected_error();
+    }
+    auto timing=test_management.format->get_timing();
+    timing.end=monotonic_time();
+    test_management.format->set_timing(timing);
+  }
+
+  void TestNode::collect_test_functions(
+      vector<TestNode const *> &nodes,
+      index_t const &index, size_t position,
+      include_trie_t const &include,
+      size_t include_position,
+      name_filter_t const &glob,
+      vector<TestNode const *> *empty_leaves) const {
+    // same selection as in "run_tests()"
+    auto [first_child, last_child]=index.children[position];
+    for (auto c=first_child; c<last_child; ++c) {
+      auto const &child=index.nodes[c];
+      if (auto child_include=include.child(include_position, child->name);
+          (child_include not_eq include_trie_t::none)
+          and child->some_matching_function(glob, index, c))
+        child->collect_test_functions(nodes, index, c,
+                                      include, child_include,
+                                      glob, empty_leaves);
+    }
+    if (test_f and matching_name(glob))
+      nodes.push_back(this);
+    else if (empty_leaves and (not test_f) and children.empty())
+      empty_leaves->push_back(this);
+  }
+
+  TestNode::listing_t TestNode::list_nodes(list<name_t> include,
+                                           list<string> glob) const {
+    auto const tree_index=index();
+    include_trie_t const include_trie(include);
+    name_filter_t const name_filter{
+      glob::pattern_set_t(glob),
+      vector<signed char>(tree_index->nodes.size(), -1)};
+    listing_t listing;
+    collect_nodes(listing, *tree_index, tree_index->position(*this),
+                  include_trie, include_trie.start(), name_filter);
+    return listing;
+  }
+
+  void TestNode::collect_nodes(listing_t &listing,
+                               index_t const &index, size_t position,
+                               include_trie_t const &include,
+                               size_t include_position,
+                               name_filter_t const &glob) const {
+    // same selection as in "run_tests()", which outputs the title first
+    listing.emplace_back(this, test_f and matching_name(glob));
+    auto [first_child, last_child]=index.children[position];
+    for (auto c=first_child; c<last_child; ++c) {
+      auto const &child=index.nodes[c];
+      if (auto child_include=include.child(include_position, child->name);
+          (child_include not_eq include_trie_t::none)
+          and child->some_matching_function(glob, index, c))
+        child->collect_nodes(listing, index, c,
+                             include, child_include, glob);
+    }
+  }
+
   namespace {
 
     void print_tree_r(ostream &os, TestNode::csptr node,
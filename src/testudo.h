@@ -31,11 +31,20 @@
 #include "testudo_format.h"
 #include "testudo_base.h"
 #include "testudo_activate.h"
+#include "testudo_benchmark.h"
 #include <string>
 #include <map>
 #include <list>
 #include <memory>
 #include <functional>
+#include <vector>
+#include <array>
+#include <tuple>
+#include <utility>
+#include <optional>
+#include <iterator>
+#include <algorithm>
+#include <cstdint>
 
 namespace testudo___implementation {
 
@@ -63,6 +72,49 @@ namespace testudo___implementation {
   using title_t=std::string;
   struct declaration_order_t { } constexpr declaration_order;
 
+  // wall times of test functions, in seconds, by full name
+  using durations_t=std::map<name_t, double>;
+
+  // the predicted and actual wall time of a run, in seconds
+  struct run_makespan_t {
+    std::optional<double> predicted;
+    double actual=0;
+  };
+
+  // how to run the selected test functions
+  struct test_run_options_t {
+    // if greater than one, run the test functions concurrently on that many
+    // threads, and then output their results in the same order, and with the
+    // same contents, as a sequential run
+    unsigned jobs=1;
+    // run the test functions instead in "jobs" worker processes, so that a
+    // test function crashing doesn't bring down the whole run, but is
+    // reported as an error
+    bool isolated=false;
+    // run only the "shard"-th (from 1 to "n_shards") out of "n_shards"
+    // balanced parts of the test functions; the split depends only on the
+    // test functions' full names and on "durations", so separate runs agree
+    // on it
+    unsigned shard=1, n_shards=1;
+    // if not null, the durations of test functions in previous runs, used
+    // to run the longest first, and to balance shards by duration, and,
+    // after the run, updated with the durations in this run
+    durations_t *durations=nullptr;
+    // if not null, set, after the run, to its actual wall time, and to the
+    // one predicted from "durations" (if there were any)
+    run_makespan_t *run_makespan=nullptr;
+    // if positive, and "isolated", a test function running for longer than
+    // that many seconds has its worker process killed, and is reported as
+    // an error, as if it had crashed
+    double timeout=0.;
+  };
+
+  // the "include" argument of "TestNode::test()", made into a trie of name
+  // parts (defined in "testudo.cpp")
+  class include_trie_t;
+  // the "glob" argument of "TestNode::test()", compiled (likewise)
+  struct name_filter_t;
+
   /*
         .--------------------------.
         | TestNode                 |<------------------.
@@ -104,10 +156,21 @@ namespace testudo___implementation {
     // "get_node()" retrieves a test node by its full name; if it doesn't
     // exist, it, and any missing ancestors, are created as unset nodes
     static sptr get_node(name_t const &full_name);
+    // "find_node()" retrieves a test node by its full name, the root
+    // node's included; if it doesn't exist, it returns null, and creates
+    // nothing
+    static sptr find_node(name_t const &full_name);
+    // if set, called whenever a node is created or set (e.g., to find out
+    // which nodes each test library defines, as it's loaded)
+    using registration_observer_t=std::function<void (TestNode const &)>;
+    static registration_observer_t &registration_observer();
 
     using priority_t=unsigned long int;
     static priority_t const priority_default=0;
     using test_f_t=std::function<void (test_management_t)>;
+    // benchmarks are test functions that measure times, so they're never run
+    // concurrently with other test functions
+    enum class test_kind_t { test, benchmark };
 
     // make a new node, child to the specified parent
     template <typename... A>
@@ -134,18 +197,51 @@ namespace testudo___implementation {
     pptr const parent;
     name_t const name, full_name;
 
+    bool is_benchmark() const { return kind==test_kind_t::benchmark; }
+
     // recursively run tests, depth-first, children first, and print the
     // readout to the supplied stream; if "include" isn't empty, run only those
     // nodes and their descendants; if "glob" isn't empty, run only nodes with
     // matching full names
     TestStats test(test_format_p,
                    std::list<name_t> include={},
-                   std::list<std::string> glob={}) const;
+                   std::list<std::string> glob={},
+                   test_run_options_t const &options={}) const;
+
+    // what to do with a node's own test function when its turn comes:
+    // either run it, or replay its output if it has already been run
+    using run_test_f_t=
+      std::function<void (TestNode const &, test_management_t)>;
+    // a subset of the test functions: a node is a key if its subtree has
+    // some selected test function, and its value says whether its own test
+    // function is selected
+    using selection_t=std::map<TestNode const *, bool>;
+
+    // output, as "test()" would, the selected test functions, using
+    // "replay_test" instead of running them, and print the readout
+    TestStats replay(test_format_p,
+                     selection_t const &selection,
+                     run_test_f_t const &replay_test) const;
     // the ordered list of children is constructed thus: first, the
     // declaration-ordered children, in the order they were declared, then
     // prioritised children, according to their priority (smaller first); if
     // several children have the same priority, alphabetical order
     std::list<sptr> ordered_children() const;
+    bool has_test_function() const { return bool(test_f); }
+    title_t const &get_title() const { return title; }
+    // none for declaration-ordered or unset nodes
+    std::optional<priority_t> get_priority() const {
+      return
+        (set_title_and_bucket and not set_declaration_order)
+        ? std::optional<priority_t>(priority) : std::nullopt;
+    }
+
+    // the nodes "test()" would output, with the same arguments, in the same
+    // order, but without running anything; each one comes with whether its
+    // own test function would be run
+    using listing_t=std::vector<std::pair<TestNode const *, bool>>;
+    listing_t list_nodes(std::list<name_t> include={},
+                         std::list<std::string> glob={}) const;
   private:
     // untitled, unprioritised node
     TestNode(TestFormat::location_t, pptr parent, name_t name);
@@ -153,12 +249,49 @@ namespace testudo___implementation {
     // get a child by name
     sptr get_child(TestFormat::location_t, name_t name);
 
+    // the flattened index of the whole tree: every node, with the ordered
+    // children of each one contiguous, and a hash map by full name; it's
+    // built on first use after any node has been added or set, which, in
+    // practice, means once, after all the test libraries have been loaded;
+    // a run keeps the index it started with, even if nodes are added
+    // meanwhile (e.g., by "get_node()" in a test function)
+    struct index_t;
+    using index_p=std::shared_ptr<index_t const>;
+    static index_p index();
+    static void invalidate_index();
+
     // recursively run tests: run the children's tests in order, depth-first,
-    // then own test function if set; if "include" isn't empty, run only those
-    // nodes
+    // then own test function if set; the children are taken from "index",
+    // where this node is at "position"; run only the nodes included from
+    // "include_position" in "include"; if "selection" isn't null, run only
+    // the test functions it selects
     void run_tests(test_management_t test_management,
-                   std::list<name_t> include,
-                   std::list<std::string> glob) const;
+                   index_t const &index, std::size_t position,
+                   include_trie_t const &include,
+                   std::size_t include_position,
+                   name_filter_t const &glob,
+                   run_test_f_t const &run_test,
+                   selection_t const *selection=nullptr) const;
+    // run own test function, catching any exception escaping it
+    void run_test_function(test_management_t test_management) const;
+    // collect, in sequential-run order, the nodes whose test functions
+    // "run_tests()" would run, and, if "empty_leaves" isn't null, the
+    // childless nodes without a test function it would output
+    void collect_test_functions(
+      std::vector<TestNode const *> &nodes,
+      index_t const &index, std::size_t position,
+      include_trie_t const &include,
+      std::size_t include_position,
+      name_filter_t const &glob,
+      std::vector<TestNode const *> *empty_leaves=nullptr) const;
+
+    // collect, in the order "run_tests()" would output them, the nodes it
+    // would output
+    void collect_nodes(listing_t &listing,
+                       index_t const &index, std::size_t position,
+                       include_trie_t const &include,
+                       std::size_t include_position,
+                       name_filter_t const &glob) const;
 
     // null setting
     void set() { }
@@ -174,15 +307,26 @@ namespace testudo___implementation {
       set(std::forward<A>(a)...);
       test_f=set_test_f;
     }
+    // test kind, then test function and possibly other things
+    template <typename... A>
+    void set(test_kind_t set_kind, test_f_t set_test_f, A &&...a) {
+      set(set_test_f, std::forward<A>(a)...);
+      kind=set_kind;
+    }
 
-    bool matching_name(std::list<std::string> glob) const;
-    bool some_matching_function(std::list<std::string> glob) const;
+    bool matching_name(name_filter_t const &glob) const;
+    // whether this node's subtree has some test function with a matching
+    // name; worked out once per node and filter
+    bool some_matching_function(name_filter_t const &glob,
+                                index_t const &index,
+                                std::size_t position) const;
 
     bool set_title_and_bucket=false;
     title_t title;
     priority_t priority;
     bool set_declaration_order=false;
     test_f_t test_f;
+    test_kind_t kind=test_kind_t::test;
     // all children
     std::map<name_t, sptr> children;
     // order among the children with "declaration_order"
@@ -199,8 +343,17 @@ namespace testudo___implementation {
   test_management.format->set_location({file, #line})
 
 
-#define testudo___TEST_NAME(n) testudo___CAT(testudo____TEST_, n)
-#define testudo___TEST_FUNCTION_NAME(n) testudo____TEST_FUNCTION_##n
+  // the names of test nodes and test functions include "testudo___UNIT",
+  // which is empty, except in unity builds, where several ".ttd" files are
+  // compiled together, and it's redefined before each of them, so that test
+  // nodes with the same id (or defined on the same line) don't clash
+#ifndef testudo___UNIT
+#define testudo___UNIT
+#endif
+#define testudo___TEST_NAME(n)                                          \
+  testudo___CAT(testudo____TEST_, testudo___CAT(testudo___UNIT, n))
+#define testudo___TEST_FUNCTION_NAME(n)                                 \
+  testudo___CAT(testudo____TEST_FUNCTION_, testudo___CAT(testudo___UNIT, n))
 
 #define testudo___NAME_TITLE(name, title) name, title
 
@@ -386,17 +539,37 @@ namespace testudo___implementation {
   testudo___DEFINE_TEST_IMPL(                                           \
     loc,                                                                \
     testudo___TAKE_2ND loc,                                             \
+    testudo::TestNode::test_kind_t::test,                               \
     ancestors, __VA_ARGS__)
 #define testudo__DEFINE_TEST_L(loc, parent, ...)                        \
   testudo___DEFINE_TEST_IMPL(                                           \
     loc,                                                                \
     testudo___TAKE_2ND loc,                                             \
+    testudo::TestNode::test_kind_t::test,                               \
+    testudo___TEST_NAME(parent),                                        \
+    __VA_ARGS__, testudo___implementation::declaration_order)
+
+  // a benchmark is defined just like a test, with "define_benchmark()" or
+  // "define_top_benchmark()"; it's a test whose function is meant to time
+  // code (with "benchmark()" and "check_time()"), so it's never run
+  // concurrently with other test functions, nor in a worker process
+#define testudo__DEFINE_TOP_BENCHMARK_L(loc, ancestors, ...)            \
+  testudo___DEFINE_TEST_IMPL(                                           \
+    loc,                                                                \
+    testudo___TAKE_2ND loc,                                             \
+    testudo::TestNode::test_kind_t::benchmark,                          \
+    ancestors, __VA_ARGS__)
+#define testudo__DEFINE_BENCHMARK_L(loc, parent, ...)                   \
+  testudo___DEFINE_TEST_IMPL(                                           \
+    loc,                                                                \
+    testudo___TAKE_2ND loc,                                             \
+    testudo::TestNode::test_kind_t::benchmark,                          \
     testudo___TEST_NAME(parent),                                        \
     __VA_ARGS__, testudo___implementation::declaration_order)
 
-#define testudo___DEFINE_TEST_IMPL(loc, line, l_a_or_p, ...)            \
+#define testudo___DEFINE_TEST_IMPL(loc, line, kind, l_a_or_p, ...)      \
   testudo___DEFINE_TEST_ID_KEY_TITLE(                                   \
-    loc, line,                                                          \
+    loc, line, kind,                                                    \
     l_a_or_p,                                                           \
     testudo___ID_KEY_TITLE(line, testudo___FIRST(__VA_ARGS__))          \
     testudo___COMMA_REST(__VA_ARGS__),                                  \
@@ -404,7 +577,7 @@ namespace testudo___implementation {
 #define testudo___DEFINE_TEST_ID_KEY_TITLE(...)                         \
   testudo___DEFINE_TEST_ID_KEY_TITLE_IMPL(__VA_ARGS__)
 #define testudo___DEFINE_TEST_ID_KEY_TITLE_IMPL(                        \
-    loc, line, l_a_or_p, id, key, title, ...)                           \
+    loc, line, kind, l_a_or_p, id, key, title, ...)                     \
   /* define a class for the test: */                                    \
   namespace {                                                           \
     struct testudo___TEST_FUNCTION_NAME(id)                             \
@@ -422,7 +595,9 @@ namespace testudo___implementation {
                   ::make_null_test_format_for_fixtures(                 \
                      test_management.format)),                          \
               test_management.test_vfos,                                \
-              test_management.stats},                                   \
+              test_management.stats,                                    \
+              test_management.test_name,                                \
+              test_management.job_budget},                              \
             select_fixture_args(__VA_ARGS__),                           \
             std::make_index_sequence<                                   \
               decltype(select_fixture_args(__VA_ARGS__))::size>()),      \
@@ -448,7 +623,7 @@ namespace testudo___implementation {
   static inline auto testudo___TEST_NAME(id)=                           \
     testudo::TestNode::make_node(                                       \
       testudo___LOCATION loc,                                           \
-      l_a_or_p, key,                                                    \
+      l_a_or_p, key, kind,                                              \
       testudo::TestNode::test_f_t(                                      \
         [](testudo::test_management_t test_management) {                \
           auto fixture_spec=select_fixture_spec(__VA_ARGS__);           \
@@ -460,9 +635,22 @@ namespace testudo___implementation {
                : "with fixture ")                                       \
               +fixture_spec.fixture_name                                \
               +fixture_args.args_text());                               \
-          testudo___TEST_FUNCTION_NAME(id) fixture(                     \
-            test_management, fixture_spec.visible);                     \
-          fixture.perform_test();                                       \
+          auto timing=test_management.format->get_timing();             \
+          double setup_end, teardown_start;                             \
+          {                                                             \
+            testudo___TEST_FUNCTION_NAME(id) fixture(                   \
+              test_management, fixture_spec.visible);                   \
+            setup_end=testudo___implementation::monotonic_time();       \
+            fixture.perform_test();                                     \
+            teardown_start=testudo___implementation::monotonic_time();  \
+          }                                                             \
+          if (not fixture_spec.fixture_name.empty()) {                  \
+            timing.fixture_setup=setup_end-timing.start;                \
+            timing.fixture_teardown=                                    \
+              testudo___implementation::monotonic_time()                \
+              -teardown_start;                                          \
+            test_management.format->set_timing(timing);                 \
+          }                                                             \
         }),                                                             \
       title, testudo___implementation::select_priority(__VA_ARGS__));   \
   /* start the definition of "do_this_test()", but stop just before */  \
@@ -671,6 +859,92 @@ namespace testudo___implementation {
   template <typename T>
   auto to_testudo_container(T const &t) { return t; }
 
+  // "with()"-loop data that say which data they are (e.g., a pseudorandom
+  // sample, with its seed) have a "coverage()" member function
+  template <typename C>
+  auto data_coverage(C const &c, int) -> decltype(std::string(c.coverage()))
+    { return c.coverage(); }
+  template <typename C>
+  std::string data_coverage(C const &, long) { return {}; }
+
+  // "with()"-loop data, to be gone through until "max_failed" iterations
+  // have failed (see "stop_after_failures()")
+  template <typename C>
+  struct failure_limited_data_t {
+    bool empty() const { return data.empty(); }
+    C data;
+    std::size_t max_failed;
+  };
+
+  // the iterations of a "with()"-loop; which iteration is the last one must
+  // be known before it's run, since it reports the contents of the loop, so
+  // "last_time()" must be called once at the beginning of each iteration;
+  // when "max_failed" iterations have failed, the next one is the last
+  template <typename C>
+  class with_loop_range_t {
+  public:
+    with_loop_range_t(C &container, std::shared_ptr<WithLoopLog> log,
+                      std::size_t max_failed=std::size_t(-1))
+      : container(container), log_p(log), max_failed(max_failed),
+        size(container.size()) {
+      set_coverage(*log_p, data_coverage(container, 0));
+    }
+    std::shared_ptr<WithLoopLog> log() const { return log_p; }
+    bool last_time() {
+      last=(i+1==size);
+      if (not last and failed_iterations(*log_p)>=max_failed) {
+        last=true;
+        auto coverage=data_coverage(container, 0);
+        auto failed=failed_iterations(*log_p);
+        set_coverage(
+          *log_p,
+          (coverage.empty() ? "" : coverage+"; ")
+          +"stopped after "+std::to_string(failed)+" failed iteration"
+          +(failed==1 ? "" : "s")+", having run "+std::to_string(i+1)
+          +" out of "+std::to_string(size));
+      }
+      return last;
+    }
+    // the loop ends when "last_time()" says so, rather than when the
+    // iterator reaches the end of the container, so "end()" is just a
+    // sentinel that doesn't touch the container (which, for generated data,
+    // would generate a value that would then be lost)
+    struct sentinel_t { };
+    class iterator {
+    public:
+      using base_t=decltype(std::begin(std::declval<C &>()));
+      iterator(with_loop_range_t *range, base_t base)
+        : range(range), base(base) { }
+      decltype(auto) operator*() const { return *base; }
+      iterator &operator++() {
+        ++base;
+        ++range->i;
+        return *this;
+      }
+      bool operator!=(sentinel_t) const { return not range->last; }
+    private:
+      with_loop_range_t *range;
+      base_t base;
+    };
+    iterator begin() { return {this, std::begin(container)}; }
+    sentinel_t end() { return {}; }
+  private:
+    C &container;
+    std::shared_ptr<WithLoopLog> const log_p;
+    std::size_t const max_failed, size;
+    std::size_t i=0;
+    bool last=false;
+  };
+
+  template <typename C>
+  auto make_with_loop_range(C &container, std::shared_ptr<WithLoopLog> log)
+    { return with_loop_range_t<C>(container, log); }
+  template <typename C>
+  auto make_with_loop_range(failure_limited_data_t<C> &limited,
+                            std::shared_ptr<WithLoopLog> log) {
+    return with_loop_range_t<C>(limited.data, log, limited.max_failed);
+  }
+
 #define testudo___REMOVE_BRACKETS(...) __VA_ARGS__
 
 #define testudo___ADD_BRACKETS(...) (__VA_ARGS__)
@@ -740,21 +1014,126 @@ namespace testudo___implementation {
       testudo___implementation::to_testudo_container(__VA_ARGS__))      \
   if (not testudo___container.empty())                                  \
     testudo___INSERT_DECLARATION(                                       \
-      auto testudo___with_log=                                          \
-        testudo___implementation::get_with_loop_log(test_management))   \
-    testudo___INSERT_DECLARATION(std::size_t testudo___container_i=0)   \
+      auto testudo___with_loop=                                         \
+        testudo___implementation::make_with_loop_range(                 \
+          testudo___container,                                          \
+          testudo___implementation::get_with_loop_log(test_management)))\
     for (auto const &testudo___REMOVE_BRACKETS n_sb:                    \
-           testudo___container)                                         \
+           testudo___with_loop)                                         \
       testudo___INSERT_DECLARATION(                                     \
         testudo___implementation::push_test_format_t push_test_format{  \
           &test_management.format,                                      \
           testudo___implementation::make_with_loop_test_format(         \
             test_management.format,                                     \
-            testudo___with_log,                                         \
-            testudo___container_i==testudo___container.size()-1,        \
+            testudo___with_loop.log(),                                  \
+            testudo___with_loop.last_time(),                            \
             #n, to_text_bind(test_management.test_vfos->fmt_os) n_b,    \
-            s)})                                                        \
-      testudo___INSERT_ACTION(++testudo___container_i)
+            s)})
+
+  // parallel "with()"-loops: the values are copied first, so that they can
+  // be taken in any order, and the body of the loop becomes a lambda, which
+  // takes its own "test_management", followed by the loop variables;
+  // "unpacked" tells whether a value must be unpacked into several loop
+  // variables (i.e., whether they were given in brackets)
+  template <typename V, typename T, bool unpacked>
+  class ParallelWithLoop {
+  public:
+    ParallelWithLoop(test_management_t test_management,
+                     std::vector<V> values,
+                     std::string var_name, MultilineData container,
+                     T to_text_f, std::string coverage)
+      : test_management(test_management), values(std::move(values)),
+        var_name(var_name), container(container), to_text_f(to_text_f),
+        coverage(coverage) { }
+    template <typename B>
+    void operator->*(B body) const {
+      run_parallel_with_loop(
+        test_management, values.size(), var_name, container,
+        [this](std::size_t i, std::ostream &fmt_os) {
+          return call(to_text_f, fmt_os, values[i]);
+        },
+        [this, &body](std::size_t i, test_management_t i_test_management) {
+          call(body, i_test_management, values[i]);
+        },
+        coverage);
+    }
+  private:
+    template <typename F, typename A>
+    static auto call(F const &f, A &&a, V const &value) {
+      if constexpr (unpacked)
+        return std::apply(
+          [&f, &a](auto const &...v) { return f(std::forward<A>(a), v...); },
+          value);
+      else
+        return f(std::forward<A>(a), value);
+    }
+    test_management_t const test_management;
+    std::vector<V> const values;
+    std::string const var_name;
+    MultilineData const container;
+    T const to_text_f;
+    std::string const coverage;
+  };
+
+  template <bool unpacked, typename C, typename T>
+  auto make_parallel_with_loop(test_management_t test_management,
+                               C &&container,
+                               std::string var_name, MultilineData s,
+                               T to_text_f) {
+    using value_t=std::decay_t<decltype(*std::begin(container))>;
+    std::vector<value_t> values;
+    for (auto const &v: container)
+      values.push_back(v);
+    return ParallelWithLoop<value_t, T, unpacked>(
+      test_management, std::move(values), var_name, s, to_text_f,
+      data_coverage(container, 0));
+  }
+
+#define testudo___UNPACKED_IF_B_B true
+#define testudo___UNPACKED_IF_B_testudo___IF_BRACKETS_B false,
+#define testudo___UNPACKED_IF_BRACKETS(...)                             \
+    testudo___EXPAND_ARG1(                                              \
+      testudo___CAT(                                                    \
+        testudo___UNPACKED_IF_B_,                                       \
+        testudo___IF_BRACKETS_B __VA_ARGS__))
+#define testudo___COMMA_LOOP_VARIABLE(v) , [[maybe_unused]] auto const &v
+
+  // the body of a parallel "with()"-loop must be a compound statement
+  // followed by a semicolon (it's a lambda); its iterations mustn't depend
+  // on each other, nor share anything that isn't thread-safe
+#define testudo__PARALLEL_WITH_MULTILINE_DATA_L_S(loc, s, n, ...)       \
+  testudo___PARALLEL_WITH_DATA_L_S_IMPL(                                \
+    loc, testudo___implementation::break_multiline_data(s), n,          \
+    testudo___ADD_BRACKETS_IF_NEEDED(n),                                \
+    testudo___implementation::testudo___TO_TEXT_TUPLE_IF_BRACKETS(n),   \
+    __VA_ARGS__)
+#define testudo__PARALLEL_WITH_DATA_L_S(loc, s, n, ...)                 \
+  testudo___PARALLEL_WITH_DATA_L_S_IMPL(                                \
+    loc, testudo___implementation::break_data(s), n,                    \
+    testudo___ADD_BRACKETS_IF_NEEDED(n),                                \
+    testudo___implementation::testudo___TO_TEXT_TUPLE_IF_BRACKETS(n),   \
+    __VA_ARGS__)
+#define testudo___PARALLEL_WITH_DATA_L_S_IMPL(                          \
+    loc, s, n, n_b, to_text_bind, ...)                                  \
+  testudo___PARALLEL_WITH_DATA_L_S_IMPL_IMPL(                           \
+    loc, s, n, n_b, to_text_bind, __VA_ARGS__)
+#define testudo___PARALLEL_WITH_DATA_L_S_IMPL_IMPL(                     \
+    loc, s, n, n_b, to_text_bind, ...)                                  \
+  testudo___INSERT_ACTION(testudo___SET_LOCATION loc)                   \
+  testudo___implementation::make_parallel_with_loop<                    \
+    testudo___UNPACKED_IF_BRACKETS(n)>(                                 \
+      test_management,                                                  \
+      testudo___implementation::to_testudo_container(__VA_ARGS__),      \
+      #n, s,                                                            \
+      [](std::ostream &testudo___fmt_os                                 \
+         testudo___FOR_EACH(testudo___COMMA_LOOP_VARIABLE,              \
+                            testudo___REMOVE_BRACKETS n_b)) {           \
+        return to_text_bind(testudo___fmt_os) n_b;                      \
+      })                                                                \
+  ->*[&]([[maybe_unused]]                                               \
+         testudo___implementation::test_management_t test_management    \
+         testudo___FOR_EACH(testudo___COMMA_LOOP_VARIABLE,              \
+                            testudo___REMOVE_BRACKETS n_b))
 
 
   template <typename T=std::exception>
@@ -1313,6 +1692,30 @@ namespace testudo___implementation {
      return testudo___implementation::make_check(                       \
       test_management, testudo___check_type(__VA_ARGS__), s)->
 
+  // time code, and report the time per run; "check_time()" also checks the
+  // time, with "_below()" or "_no_regression()"
+#define testudo__BENCHMARK_L_S(loc, s, ...)                             \
+  testudo___BEGIN_GROUP                                                 \
+    testudo___SET_LOCATION loc;                                         \
+    testudo___implementation::measure_benchmark(                        \
+      test_management, s,                                               \
+      testudo___implementation::benchmarked(                            \
+        [&]() { return __VA_ARGS__; }));                                \
+  testudo___END_GROUP
+#define testudo__CHECK_TIME_L_S(loc, s, ...)                            \
+  (testudo___BEGIN_GROUP                                                \
+     testudo___SET_LOCATION loc;                                        \
+     return testudo___implementation::CheckTime(                        \
+       test_management, s,                                              \
+       testudo___implementation::benchmarked(                           \
+         [&]() { return __VA_ARGS__; })).
+#define testudo__BELOW_S(s, ...)                                        \
+    below(__VA_ARGS__, s);                                              \
+  testudo___END_GROUP)
+#define testudo__NO_REGRESSION_S(s, ...)                                \
+    no_regression(__VA_ARGS__, s);                                      \
+  testudo___END_GROUP)
+
 #define testudo__PROVIDED(...)                                          \
   if (auto testudo___keep_check_alive_until_end_of_if=__VA_ARGS__;      \
       testudo___keep_check_alive_until_end_of_if->make_provided())
@@ -1395,6 +1798,216 @@ namespace testudo___implementation {
     return result;
   }
 
+  // lazy data for with-data loops: instead of building a list with every
+  // datum before the loop starts, as the functions above do, the following
+  // ranges produce each datum as the loop reaches it, so memory doesn't grow
+  // with the number of data; they can be used wherever a container can
+
+  namespace implementation {
+
+    // a range of "size" data, the "i"-th one computed by "at(i)"
+    template <typename A>
+    class indexed_range_t {
+    public:
+      indexed_range_t(std::size_t size, A at, std::string coverage={})
+        : size_p(size), at(at), coverage_p(coverage) { }
+      std::size_t size() const { return size_p; }
+      std::string const &coverage() const { return coverage_p; }
+      bool empty() const { return size_p==0; }
+      auto operator[](std::size_t i) const { return at(i); }
+      class iterator {
+      public:
+        iterator(indexed_range_t const *range, std::size_t i)
+          : range(range), i(i) { }
+        auto operator*() const { return (*range)[i]; }
+        iterator &operator++() { return ++i, *this; }
+        bool operator!=(iterator const &other) const
+          { return i not_eq other.i; }
+      private:
+        indexed_range_t const *range;
+        std::size_t i;
+      };
+      iterator begin() const { return {this, 0}; }
+      iterator end() const { return {this, size_p}; }
+    private:
+      std::size_t size_p;
+      A at;
+      std::string coverage_p;
+    };
+    template <typename A>
+    auto make_indexed_range(std::size_t size, A at,
+                            std::string coverage={})
+      { return indexed_range_t<A>(size, at, coverage); }
+
+    template <typename C>
+    auto to_data_vector(C const &c) {
+      using value_t=std::decay_t<decltype(*std::begin(c))>;
+      return std::vector<value_t>(std::begin(c), std::end(c));
+    }
+
+    // the tuple of "std::get<k>(datasets)[indices[k]]" for every "k"
+    template <typename D, std::size_t... k>
+    auto pick_data(D const &datasets,
+                   std::array<std::size_t, sizeof...(k)> const &indices,
+                   std::index_sequence<k...>)
+      { return std::make_tuple(std::get<k>(datasets)[indices[k]]...); }
+
+    // a 64-bit mix of "x" (the "splitmix64" finalizer)
+    inline std::uint64_t mix_bits(std::uint64_t x) {
+      x=(x xor (x >> 30))*0xbf58476d1ce4e5b9ull;
+      x=(x xor (x >> 27))*0x94d049bb133111ebull;
+      return x xor (x >> 31);
+    }
+
+  }
+
+  // "n" data, each one generated by a call to "f()" when the loop reaches it
+  template <typename F>
+  class lazy_generate_data {
+  public:
+    lazy_generate_data(std::size_t size, F f) : size_p(size), f(f) { }
+    std::size_t size() const { return size_p; }
+    bool empty() const { return size_p==0; }
+    class iterator {
+    public:
+      iterator(lazy_generate_data *range, std::size_t i)
+        : range(range), i(i) { generate(); }
+      auto const &operator*() const { return *value; }
+      iterator &operator++() {
+        ++i;
+        generate();
+        return *this;
+      }
+      bool operator!=(iterator const &other) const
+        { return i not_eq other.i; }
+    private:
+      void generate() {
+        if (i<range->size_p)
+          value.emplace(range->f());
+      }
+      lazy_generate_data *range;
+      std::size_t i;
+      std::optional<decltype(std::declval<F &>()())> value;
+    };
+    iterator begin() { return {this, 0}; }
+    iterator end() { return {this, size_p}; }
+  private:
+    std::size_t size_p;
+    F f;
+  };
+
+  // the tuples of the cartesian product of the datasets, in the same order
+  // as "cartesian_product()" gives them; only the datasets are stored
+  template <typename... C>
+  auto lazy_cartesian_product(C const &...c) {
+    auto datasets=std::make_tuple(implementation::to_data_vector(c)...);
+    std::size_t size=1;
+    std::apply([&size](auto const &...d) { ((size*=d.size()), ...); },
+               datasets);
+    return implementation::make_indexed_range(
+      size,
+      [datasets](std::size_t i) {
+        // the last dataset varies fastest
+        std::array<std::size_t, sizeof...(C)> indices;
+        std::apply(
+          [&indices, i](auto const &...d) mutable {
+            std::size_t const sizes[]={d.size()...};
+            for (auto k=sizeof...(C); k>0; --k) {
+              indices[k-1]=i%sizes[k-1];
+              i/=sizes[k-1];
+            }
+          },
+          datasets);
+        return implementation::pick_data(
+          datasets, indices, std::index_sequence_for<C...>());
+      });
+  }
+
+  // the tuples of the "i"-th elements of each dataset, up to the shortest
+  // dataset
+  template <typename... C>
+  auto lazy_zip(C const &...c) {
+    auto datasets=std::make_tuple(implementation::to_data_vector(c)...);
+    auto size=
+      std::apply([](auto const &...d) { return std::min({d.size()...}); },
+                 datasets);
+    return implementation::make_indexed_range(
+      size,
+      [datasets](std::size_t i) {
+        return std::apply(
+          [i](auto const &...d) { return std::make_tuple(d[i]...); },
+          datasets);
+      });
+  }
+
+  // "n" data picked from "range" (anything with "size()" and "operator[]",
+  // such as a vector, or a lazy cartesian product or zip), pseudorandomly
+  // and with replacement; the picks depend only on "seed", so they're the
+  // same in every run
+  template <typename R>
+  auto lazy_sample(std::size_t n, R const &range, std::uint64_t seed=0) {
+    return implementation::make_indexed_range(
+      range.empty() ? 0 : n,
+      [range, seed](std::size_t i) {
+        return range[implementation::mix_bits(seed+i*0x9e3779b97f4a7c15ull)
+                     %range.size()];
+      },
+      "sample of "+std::to_string(n)+" out of "+std::to_string(range.size())
+      +", seed "+std::to_string(seed));
+  }
+
+  // "n" tuples from the cartesian product of the datasets, spread evenly
+  // over each dataset: every "size" consecutive tuples (where "size" is the
+  // size of the dataset) take each element of the dataset once, in a
+  // pseudorandom order, so each element is in either "n/size" or
+  // "n/size+1" tuples; the tuples depend only on "seed"
+  template <typename... C>
+  auto stratified_sample(std::size_t n, std::uint64_t seed, C const &...c) {
+    auto datasets=std::make_tuple(implementation::to_data_vector(c)...);
+    std::array<std::size_t, sizeof...(C)> sizes;
+    std::apply([&sizes](auto const &...d) { sizes={d.size()...}; },
+               datasets);
+    std::size_t size=1;
+    for (auto s: sizes)
+      size*=s;
+    if (size==0)
+      n=0;
+    std::vector<std::array<std::size_t, sizeof...(C)>> indices(n);
+    std::uint64_t draw=seed;
+    for (std::size_t k=0; k<sizes.size(); ++k) {
+      std::vector<std::size_t> block(sizes[k]);
+      for (std::size_t begin=0; begin<n; begin+=sizes[k]) {
+        // a Fisher-Yates shuffle, so that every platform gives the same one
+        for (std::size_t j=0; j<block.size(); ++j)
+          block[j]=j;
+        for (auto j=block.size(); j>1; --j)
+          std::swap(block[j-1],
+                    block[implementation::mix_bits(
+                            ++draw*0x9e3779b97f4a7c15ull)%j]);
+        for (std::size_t j=0; j<block.size() and begin+j<n; ++j)
+          indices[begin+j][k]=block[j];
+      }
+    }
+    return implementation::make_indexed_range(
+      n,
+      [datasets, indices](std::size_t i) {
+        return implementation::pick_data(
+          datasets, indices[i], std::index_sequence_for<C...>());
+      },
+      "stratified sample of "+std::to_string(n)+" out of "
+      +std::to_string(size)+", seed "+std::to_string(seed));
+  }
+
+  // go through "data" in a "with()"-loop only until "max_failed" iterations
+  // have failed; since the last iteration of a loop is the one that reports
+  // its contents, the loop ends with the iteration after that; the summary
+  // of the loop says how many iterations were run
+  template <typename C>
+  auto stop_after_failures(std::size_t max_failed, C const &data) {
+    return failure_limited_data_t<decltype(to_testudo_container(data))>{
+      to_testudo_container(data), max_failed};
+  }
+
 #define testudo__TFOS                                                   \
   test_management.test_vfos->fmt_os
 
@@ -1402,8 +2015,11 @@ namespace testudo___implementation {
 
 
 testudo___BRING(TestNode,
+                durations_t,
                 print_tree,
                 Fixture,
-                generate_data, generate_data_tuple, cartesian_product)
+                generate_data, generate_data_tuple, cartesian_product,
+                lazy_generate_data, lazy_cartesian_product, lazy_zip,
+                lazy_sample, stratified_sample, stop_after_failures)
 
 #endif
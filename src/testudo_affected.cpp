@@ -0,0 +1,243 @@
+// Copyright © 2020-2023 Miguel González Cuadrado <mgcuadrado@gmail.com>
+
+// This file is part of Testudo.
+
+//     Testudo is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+
+//     Testudo is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+
+//     You should have received a copy of the GNU General Public License
+//     along with Testudo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "testudo_affected.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <set>
+#include <unordered_map>
+#include <cstdlib>
+
+namespace testudo___implementation {
+
+  using namespace std;
+
+  namespace {
+
+    namespace fs=std::filesystem;
+
+    string canonical(string const &path) {
+      error_code ec;
+      // made absolute first, so that nonexistent files compare alike
+      // however they're written
+      auto result=fs::weakly_canonical(fs::absolute(path, ec), ec);
+      return ec ? path : result.string();
+    }
+
+    // "make" rule words: blank-separated, with "\ " for a blank in a word,
+    // and "$$" for a dollar sign
+    vector<string> make_words(string const &text) {
+      vector<string> result;
+      string word;
+      for (size_t i=0; i<text.size(); ++i) {
+        auto c=text[i];
+        if ((c=='\\') and (i+1<text.size()) and (text[i+1]==' '))
+          word+=text[++i];
+        else if ((c=='$') and (i+1<text.size()) and (text[i+1]=='$'))
+          word+=text[++i];
+        else if ((c==' ') or (c=='\t')) {
+          if (not word.empty())
+            result.push_back(word);
+          word.clear();
+        }
+        else
+          word+=c;
+      }
+      if (not word.empty())
+        result.push_back(word);
+      return result;
+    }
+
+  }
+
+  dependencies_t parse_dependencies(istream &is) {
+    dependencies_t result;
+    string line, rule;
+    while (getline(is, line)) {
+      // a backslash at the end of a line continues the rule on the next one
+      if ((not line.empty()) and (line.back()=='\\')) {
+        line.back()=' ';
+        rule+=line;
+        continue;
+      }
+      rule+=line;
+      // the first colon followed by a blank, or at the end of the rule,
+      // ends the targets
+      size_t colon=0;
+      while (((colon=rule.find(':', colon)) not_eq string::npos)
+             and (colon+1<rule.size())
+             and (rule[colon+1] not_eq ' ') and (rule[colon+1] not_eq '\t'))
+        ++colon;
+      if (colon not_eq string::npos) {
+        auto prerequisites=make_words(rule.substr(colon+1));
+        if (not prerequisites.empty())
+          for (auto const &target: make_words(rule.substr(0, colon)))
+            result[target]=prerequisites;
+      }
+      rule.clear();
+    }
+    return result;
+  }
+
+  dependencies_t read_dependencies(string const &directory) {
+    dependencies_t result;
+    error_code ec;
+    for (fs::recursive_directory_iterator d(directory, ec), end;
+         (not ec) and (d not_eq end); d.increment(ec))
+      if (d->is_regular_file() and (d->path().extension()==".td")) {
+        ifstream ifs(d->path());
+        result.merge(parse_dependencies(ifs));
+      }
+    return result;
+  }
+
+  list<name_t> affected_include(TestNode const &root,
+                                dependencies_t const &dependencies,
+                                list<string> const &libraries,
+                                list<string> const &changed,
+                                list<name_t> const &include) {
+    set<string> changed_files;
+    for (auto const &c: changed)
+      changed_files.insert(canonical(c));
+    map<string, vector<string>> canonical_dependencies;
+    for (auto const &[target, prerequisites]: dependencies)
+      canonical_dependencies[canonical(target)]=prerequisites;
+
+    // the files test nodes can come from, and those that are affected
+    set<string> known_files, affected_files;
+    bool unknown_libraries=false;
+    for (auto const &library: libraries) {
+      auto canonical_library=canonical(library);
+      auto found=canonical_dependencies.find(canonical_library);
+      if (found==canonical_dependencies.end()) {
+        unknown_libraries=true;
+        continue;
+      }
+      vector<string> files;
+      bool affected=changed_files.count(canonical_library);
+      for (auto const &prerequisite: found->second) {
+        files.push_back(canonical(prerequisite));
+        affected=affected or changed_files.count(files.back());
+      }
+      known_files.insert(files.begin(), files.end());
+      if (affected)
+        affected_files.insert(files.begin(), files.end());
+    }
+
+    // many test nodes come from the same file
+    unordered_map<string, bool> file_affected;
+    auto is_affected=
+      [&](TestNode const &node) {
+        auto const &file=node.location.file;
+        if (file.empty())
+          return false;
+        auto found=file_affected.find(file);
+        if (found==file_affected.end()) {
+          auto canonical_file=canonical(file);
+          bool affected=
+            affected_files.count(canonical_file)
+            or (unknown_libraries and not known_files.count(canonical_file));
+          found=file_affected.emplace(file, affected).first;
+        }
+        return found->second;
+      };
+
+    // whether all, and whether some, of the test functions in a subtree
+    // are affected, and whether its own is; a test function not in the
+    // subtrees "include" names isn't affected
+    struct cover_t { bool all, some, own; };
+    set<name_t> const include_set(include.begin(), include.end());
+    map<TestNode const *, cover_t> covers;
+    auto cover=
+      [&](auto &self, TestNode const &node, name_t const &name,
+          bool included) -> cover_t {
+        included=included or include_set.count(name);
+        cover_t result{true, false, false};
+        if (node.has_test_function()) {
+          result.own=included and is_affected(node);
+          result.all=result.some=result.own;
+        }
+        for (auto const &child: node.ordered_children()) {
+          auto child_cover=
+            self(self, *child,
+                 (&node==&root) ? child->name : name+"."+child->name,
+                 included);
+          result.all=result.all and child_cover.all;
+          result.some=result.some or child_cover.some;
+        }
+        covers[&node]=result;
+        return result;
+      };
+    cover(cover, root, "", include.empty());
+
+    // names are built from the root down, since they're relative to it
+    list<name_t> result;
+    auto select=
+      [&](auto &self, TestNode const &node, name_t const &name) -> void {
+        auto const &node_cover=covers[&node];
+        if (not node_cover.some)
+          return;
+        // the root can't be selected by name
+        if ((&node not_eq &root)
+            and (node_cover.all
+                 or node_cover.own))
+          result.push_back(name);
+        else
+          for (auto const &child: node.ordered_children())
+            self(self, *child,
+                 (&node==&root) ? child->name : name+"."+child->name);
+      };
+    select(select, root, "");
+    return result;
+  }
+
+  void testudo_affected(opts_t opts) {
+    string dependencies_directory=".depend", subtree;
+    list<string> changed, libraries;
+    list<name_t> include;
+    while (opts) {
+      if (auto m=opts.opt_arg("-M"))
+        dependencies_directory=m;
+      else if (auto s=opts.opt_arg("-s"))
+        subtree=s;
+      else if (auto i=opts.opt_arg("-i"))
+        include.push_back(i);
+      else if (auto c=opts.opt_arg("-c"))
+        changed.push_back(c);
+      else
+        libraries.push_back(opts.arg());
+    }
+    if (not load_test_libraries(libraries))
+      exit(2);
+    auto root=testudo__TOP_TEST_NODE(subtree);
+    if (not root) {
+      cerr << opts.executable << ": unknown node \"" << subtree << "\""
+           << endl;
+      exit(2);
+    }
+    auto affected=
+      affected_include(*root, read_dependencies(dependencies_directory),
+                       libraries, changed, include);
+    for (auto const &i: affected)
+      cout << "-i " << i << endl;
+    if (affected.empty())
+      exit(1);
+  }
+
+}
@@ -0,0 +1,73 @@
+// Copyright © 2020-2023 Miguel González Cuadrado <mgcuadrado@gmail.com>
+
+// This file is part of Testudo.
+
+//     Testudo is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+
+//     Testudo is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+
+//     You should have received a copy of the GNU General Public License
+//     along with Testudo.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MGCUADRADO_TESTUDO_AFFECTED_HEADER_
+#define MGCUADRADO_TESTUDO_AFFECTED_HEADER_
+
+#include "testudo_opt.h"
+#include "testudo.h"
+#include <istream>
+#include <string>
+#include <list>
+#include <vector>
+#include <map>
+
+namespace testudo___implementation {
+
+  // the prerequisites of each target, as written by the compiler for "make"
+  // (e.g., with "-MMD"), in the order they're written (so, for a test
+  // library, its source file comes first); targets without prerequisites
+  // (such as those added by "-MP") are left out
+  using dependencies_t=std::map<std::string, std::vector<std::string>>;
+  dependencies_t parse_dependencies(std::istream &);
+  // parse every ".td" file (the dependencies of a test library) under
+  // "directory"
+  dependencies_t read_dependencies(std::string const &directory);
+
+  // the fewest "-i" names (relative to "root", as "TestNode::test()" takes
+  // them) that select every test function affected by the "changed" files:
+  // a test library is affected if itself or any of its prerequisites
+  // changed, and a test node is affected if the file it's defined in (its
+  // location) is a prerequisite of an affected library; a node whose test
+  // functions are all affected is selected whole (which, if it has an own
+  // test function, includes its descendants); paths are compared once made
+  // canonical, relative paths being taken from the current directory, like
+  // those in the dependencies; if some library has no dependencies, test
+  // nodes from files unknown to the dependencies are taken as affected; if
+  // no test function is affected, the result is empty; if "include" (with
+  // names relative to "root" too) isn't empty, only the test functions in
+  // the subtrees it names can be affected, so that the result selects the
+  // intersection of both
+  std::list<name_t> affected_include(
+    TestNode const &root,
+    dependencies_t const &dependencies,
+    std::list<std::string> const &libraries,
+    std::list<std::string> const &changed,
+    std::list<name_t> const &include={});
+
+  // print the "-i" options that select the test nodes affected by the
+  // changed files, one per line, to be passed to "testudo run" instead of
+  // the "-i" options given, if any; the exit status is 1 if none is
+  // affected:
+  //
+  //     testudo affected [-M <dependencies_directory>] [-s <subtree>]
+  //                      [-i <node>]... -c <changed_file>... <library>...
+  void testudo_affected(opts_t);
+
+}
+
+#endif
@@ -0,0 +1,117 @@
+// Copyright © 2020-2023 Miguel González Cuadrado <mgcuadrado@gmail.com>
+
+// This file is part of Testudo.
+
+//     Testudo is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+
+//     Testudo is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+
+//     You should have received a copy of the GNU General Public License
+//     along with Testudo.  If not, see <http://www.gnu.org/licenses/>.
+
+// replacements for the global allocation functions that count, by thread,
+// the calls to every form of "operator new()"; they're not part of the
+// Testudo library, but a library of their own, which a test run can preload
+// to have benchmarks report allocations:
+//
+//     LD_PRELOAD=libtestudo_allocations.so testudo run ...
+//
+// benchmarks find the count through "testudo_allocation_count()"; when it's
+// not there, they report allocations as not counted
+
+#include <new>
+#include <cstdint>
+#include <cstdlib>
+
+namespace {
+
+  thread_local std::uint64_t n_allocations=0;
+
+  void *allocate(std::size_t size) {
+    ++n_allocations;
+    if (size==0)
+      size=1;
+    while (true) {
+      if (void *p=std::malloc(size))
+        return p;
+      if (auto handler=std::get_new_handler())
+        handler();
+      else
+        throw std::bad_alloc();
+    }
+  }
+
+  void *allocate(std::size_t size, std::align_val_t alignment) {
+    ++n_allocations;
+    auto a=static_cast<std::size_t>(alignment);
+    if (a<sizeof(void *))
+      a=sizeof(void *);
+    // "aligned_alloc()" needs a size multiple of the alignment
+    size=(size==0) ? a : (size+a-1)/a*a;
+    while (true) {
+      if (void *p=std::aligned_alloc(a, size))
+        return p;
+      if (auto handler=std::get_new_handler())
+        handler();
+      else
+        throw std::bad_alloc();
+    }
+  }
+
+  template <typename... Args>
+  void *allocate_nothrow(Args... args) noexcept {
+    try {
+      return allocate(args...);
+    }
+    catch (...) {
+      return nullptr;
+    }
+  }
+
+}
+
+extern "C" std::uint64_t testudo_allocation_count() { return n_allocations; }
+
+void *operator new(std::size_t size) { return allocate(size); }
+void *operator new[](std::size_t size) { return allocate(size); }
+void *operator new(std::size_t size, std::nothrow_t const &) noexcept
+  { return allocate_nothrow(size); }
+void *operator new[](std::size_t size, std::nothrow_t const &) noexcept
+  { return allocate_nothrow(size); }
+void *operator new(std::size_t size, std::align_val_t alignment)
+  { return allocate(size, alignment); }
+void *operator new[](std::size_t size, std::align_val_t alignment)
+  { return allocate(size, alignment); }
+void *operator new(std::size_t size, std::align_val_t alignment,
+                   std::nothrow_t const &) noexcept
+  { return allocate_nothrow(size, alignment); }
+void *operator new[](std::size_t size, std::align_val_t alignment,
+                     std::nothrow_t const &) noexcept
+  { return allocate_nothrow(size, alignment); }
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::nothrow_t const &) noexcept
+  { std::free(p); }
+void operator delete[](void *p, std::nothrow_t const &) noexcept
+  { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept
+  { std::free(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept
+  { std::free(p); }
+void operator delete(void *p, std::align_val_t,
+                     std::nothrow_t const &) noexcept
+  { std::free(p); }
+void operator delete[](void *p, std::align_val_t,
+                       std::nothrow_t const &) noexcept
+  { std::free(p); }
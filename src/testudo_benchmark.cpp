@@ -0,0 +1,242 @@
+// Copyright © 2020-2023 Miguel González Cuadrado <mgcuadrado@gmail.com>
+
+// This file is part of Testudo.
+
+//     Testudo is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+
+//     Testudo is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+
+//     You should have received a copy of the GNU General Public License
+//     along with Testudo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "testudo_benchmark.h"
+#include "testudo_stats.h"
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <mutex>
+#include <sstream>
+#include <iomanip>
+#include <dlfcn.h>
+
+namespace testudo___implementation {
+
+  using namespace std;
+
+  optional<uint64_t> allocation_count() {
+    // provided by "libtestudo_allocations.so", if preloaded
+    using count_f=uint64_t ();
+    static auto const count=
+      reinterpret_cast<count_f *>(
+        dlsym(RTLD_DEFAULT, "testudo_allocation_count"));
+    if (not count)
+      return {};
+    return count();
+  }
+
+  namespace {
+
+    double now() {
+      return
+        chrono::duration<double>(
+          chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // two-sided 95% quantiles of Student's t distribution, by degrees of
+    // freedom (from 1 to 30); beyond that, the normal distribution's
+    double t_quantile(size_t degrees_of_freedom) {
+      static double const table[]={
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+        2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101,
+        2.093, 2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052,
+        2.048, 2.045, 2.042};
+      size_t const n=sizeof(table)/sizeof(table[0]);
+      return
+        (degrees_of_freedom==0) ? 0.
+        : (degrees_of_freedom<=n) ? table[degrees_of_freedom-1]
+        : 1.960;
+    }
+
+    // linearly interpolated quantile of sorted values
+    double quantile(vector<double> const &sorted, double q) {
+      double position=q*static_cast<double>(sorted.size()-1);
+      auto i=static_cast<size_t>(position);
+      if (i+1>=sorted.size())
+        return sorted.back();
+      double fraction=position-static_cast<double>(i);
+      return sorted[i]+fraction*(sorted[i+1]-sorted[i]);
+    }
+
+    string number(double x, int precision=4) {
+      ostringstream oss;
+      oss << setprecision(precision) << x;
+      return oss.str();
+    }
+
+    string nanoseconds(double seconds) {
+      ostringstream oss;
+      oss << fixed << setprecision(1) << seconds*1e9;
+      return oss.str();
+    }
+
+    mutex measurements_mutex;
+    benchmark_baseline_t measurements;
+
+  }
+
+  benchmark_result_t run_benchmark(function<void ()> const &f) {
+    auto const &options=benchmark_options;
+    auto run=
+      [&f](uint64_t iterations) {
+        double start=now();
+        for (uint64_t i=0; i<iterations; ++i)
+          f();
+        return now()-start;
+      };
+
+    benchmark_result_t result;
+    // calibration
+    uint64_t iterations=1;
+    double elapsed=run(iterations);
+    while ((elapsed<options.sample_time) and (iterations<(uint64_t(1)<<40))) {
+      iterations*=2;
+      elapsed=run(iterations);
+    }
+    result.iterations=iterations;
+    // warm-up
+    for (double warmup=elapsed; warmup<options.warmup_time;)
+      warmup+=run(iterations);
+    // samples
+    // the samples are reserved beforehand, so that their growth isn't
+    // counted as the benchmark's allocations
+    auto const n_samples=max<size_t>(options.n_samples, 2);
+    vector<double> samples;
+    samples.reserve(n_samples);
+    auto allocations_before=allocation_count();
+    for (size_t i=0; i<n_samples; ++i)
+      samples.push_back(run(iterations)/static_cast<double>(iterations));
+    auto allocations_after=allocation_count();
+    result.n_samples=samples.size();
+    if (allocations_before and allocations_after)
+      result.allocations_per_op=
+        static_cast<double>(*allocations_after-*allocations_before)
+        /static_cast<double>(iterations*samples.size());
+    // outliers
+    auto sorted=samples;
+    sort(sorted.begin(), sorted.end());
+    double q1=quantile(sorted, .25), q3=quantile(sorted, .75);
+    double low_fence=q1-1.5*(q3-q1), high_fence=q3+1.5*(q3-q1);
+    vector<double> kept;
+    for (auto s: samples)
+      if ((s>=low_fence) and (s<=high_fence))
+        kept.push_back(s);
+    result.n_outliers=samples.size()-kept.size();
+    result.samples=samples;
+    // mean and confidence interval
+    auto n=static_cast<double>(kept.size());
+    double mean=accumulate(kept.begin(), kept.end(), 0.)/n;
+    double sum_squares=0.;
+    for (auto s: kept)
+      sum_squares+=(s-mean)*(s-mean);
+    double standard_error=
+      (kept.size()>1) ? sqrt(sum_squares/(n-1.))/sqrt(n) : 0.;
+    double half_width=t_quantile(kept.size()-1)*standard_error;
+    result.seconds_per_op=mean;
+    result.ci_low=mean-half_width;
+    result.ci_high=mean+half_width;
+    return result;
+  }
+
+  benchmark_baseline_t &benchmark_baseline() {
+    static benchmark_baseline_t baseline;
+    return baseline;
+  }
+
+  benchmark_baseline_t benchmark_measurements() {
+    lock_guard<mutex> lock(measurements_mutex);
+    return measurements;
+  }
+
+  string benchmark_key(test_management_t test_management, string code_str)
+    { return test_management.test_name+": "+code_str; }
+
+  benchmark_result_t measure_benchmark(test_management_t test_management,
+                                       string code_str,
+                                       function<void ()> const &f) {
+    auto result=run_benchmark(f);
+    {
+      lock_guard<mutex> lock(measurements_mutex);
+      measurements[benchmark_key(test_management, code_str)]=
+        result.seconds_per_op;
+    }
+    string sample_times;
+    for (auto s: result.samples)
+      sample_times+=(sample_times.empty() ? "" : " ")+nanoseconds(s);
+    test_management.format
+      ->output_benchmark(code_str,
+                         nanoseconds(result.seconds_per_op),
+                         nanoseconds(result.ci_low),
+                         nanoseconds(result.ci_high),
+                         (result.allocations_per_op
+                          ? number(*result.allocations_per_op, 3)
+                          : ""),
+                         to_string(result.n_samples),
+                         to_string(result.iterations),
+                         to_string(result.n_outliers),
+                         sample_times);
+    return result;
+  }
+
+  CheckTime::CheckTime(test_management_t test_management, string code_str,
+                       function<void ()> const &f)
+    : test_management(test_management), code_str(code_str),
+      location(test_management.format->get_full_location()),
+      result(measure_benchmark(test_management, code_str, f)) { }
+
+  bool CheckTime::output(string expr_str, bool success, string explanation) {
+    string text_result=TestFormat::bool_to_string(success);
+    test_management.format->set_location(location);
+    // the measured time is shown only on failure, so that reports are
+    // repeatable
+    test_management.format
+      ->output_check_true(expr_str,
+                          success ? "" : "time per run",
+                          success ? "" : (number(result.seconds_per_op)
+                                          +" s in ["+number(result.ci_low)
+                                          +", "+number(result.ci_high)
+                                          +"]"),
+                          explanation, text_result, "", false);
+    test_management.stats+=check_result(text_result);
+    return success;
+  }
+
+  bool CheckTime::below(double seconds, string seconds_str) {
+    return
+      output("time("+code_str+") < "+seconds_str+" s",
+             result.ci_high<seconds,
+             "the confidence interval reaches the limit");
+  }
+
+  bool CheckTime::no_regression(double tolerance, string tolerance_str) {
+    auto const &baseline=benchmark_baseline();
+    auto found=baseline.find(benchmark_key(test_management, code_str));
+    bool success=
+      (found==baseline.end())
+      or (result.ci_low<=found->second*(1.+tolerance));
+    string explanation=
+      (found==baseline.end()) ? ""
+      : "baseline "+number(found->second)+" s, tolerance "+tolerance_str;
+    return
+      output("time("+code_str+") <= baseline +"+tolerance_str,
+             success, explanation);
+  }
+
+}
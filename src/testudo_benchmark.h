@@ -0,0 +1,125 @@
+// Copyright © 2020-2023 Miguel González Cuadrado <mgcuadrado@gmail.com>
+
+// This file is part of Testudo.
+
+//     Testudo is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+
+//     Testudo is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+
+//     You should have received a copy of the GNU General Public License
+//     along with Testudo.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MGCUADRADO_TESTUDO_BENCHMARK_HEADER_
+#define MGCUADRADO_TESTUDO_BENCHMARK_HEADER_
+
+#include "testudo_format.h"
+#include <string>
+#include <map>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+namespace testudo___implementation {
+
+  // the result of timing a piece of code: the number of samples, each one
+  // running the code "iterations" times; the mean time per run, in seconds,
+  // over the samples that weren't rejected as outliers, and its 95%
+  // confidence interval; and the mean number of allocations per run, if
+  // they're counted
+  struct benchmark_result_t {
+    std::uint64_t iterations=0;
+    std::size_t n_samples=0, n_outliers=0;
+    double seconds_per_op=0., ci_low=0., ci_high=0.;
+    std::optional<double> allocations_per_op={};
+    std::vector<double> samples={}; // time per run of every sample
+  };
+
+  // how to time a piece of code: first, the number of iterations per sample
+  // is doubled until a sample lasts at least "sample_time"; then, samples
+  // are taken, and discarded, for at least "warmup_time"; finally,
+  // "n_samples" samples are taken; samples outside Tukey's fences (1.5 times
+  // the interquartile range beyond the quartiles) are rejected as outliers
+  struct benchmark_options_t {
+    double sample_time=2e-3;
+    double warmup_time=10e-3;
+    std::size_t n_samples=15;
+  };
+  inline benchmark_options_t benchmark_options;
+
+  // keep the compiler from optimising away the computation of "value"
+  template <typename T>
+  void do_not_optimize(T const &value) {
+    static_cast<void>(
+      *reinterpret_cast<char const volatile *>(std::addressof(value)));
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+  }
+
+  // the number of calls to "operator new()" from this thread so far, if
+  // they're counted (i.e., if "libtestudo_allocations.so" is preloaded)
+  std::optional<std::uint64_t> allocation_count();
+
+  benchmark_result_t run_benchmark(std::function<void ()> const &f);
+
+  // benchmark baselines are the times per run, in seconds, by benchmark key
+  // (the full name of the test, a colon, and the benchmarked code); the
+  // baseline to compare against is set before running the tests, and every
+  // benchmark is recorded as it's run, so that the measurements can be
+  // saved as the next baseline
+  using benchmark_baseline_t=std::map<std::string, double>;
+  benchmark_baseline_t &benchmark_baseline();
+  benchmark_baseline_t benchmark_measurements();
+  std::string benchmark_key(test_management_t test_management,
+                            std::string code_str);
+
+  // time "f", output the result, and record it
+  benchmark_result_t measure_benchmark(test_management_t test_management,
+                                       std::string code_str,
+                                       std::function<void ()> const &f);
+
+  // run "f", in a way that its result, if any, can't be optimised away
+  template <typename F>
+  std::function<void ()> benchmarked(F f) {
+    return
+      [f]() {
+        if constexpr (std::is_void_v<decltype(f())>)
+          f();
+        else
+          do_not_optimize(f());
+      };
+  }
+
+  // checks on a benchmark result: that its time per run is below a limit
+  // (i.e., the upper end of its confidence interval is), and that it's not
+  // slower than its baseline by more than a relative tolerance (i.e., the
+  // lower end of its confidence interval isn't); if there's no baseline,
+  // the latter check passes
+  class CheckTime {
+  public:
+    // time "f", output the result, and keep it for the check
+    CheckTime(test_management_t test_management, std::string code_str,
+              std::function<void ()> const &f);
+    bool below(double seconds, std::string seconds_str);
+    bool no_regression(double tolerance, std::string tolerance_str);
+  private:
+    test_management_t const test_management;
+    std::string const code_str;
+    // outputting the benchmark consumes the location, so it's kept for the
+    // check
+    TestFormat::location_t const location;
+    benchmark_result_t const result;
+    bool output(std::string expr_str, bool success, std::string explanation);
+  };
+
+}
+
+#endif
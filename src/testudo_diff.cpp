@@ -24,7 +24,19 @@
 #include <fstream>
 #include <sstream>
 #include <iterator>
+#include <unordered_map>
+#include <iomanip>
+#include <cmath>
 #include <cassert>
+#include <charconv>
+#include <thread>
+#include <exception>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 using namespace cyclic_redundancy_check;
 using namespace std;
@@ -35,11 +47,6 @@ namespace testudo___implementation {
 
     using namespace diff_implementation;
 
-    auto read_track(string file_name) {
-      ifstream file(file_name);
-      return diff_implementation::parse_track(file);
-    }
-
     string typeset_address(string a) { return a; }
     string typeset_address(string s, string t) {
       string
@@ -88,6 +95,26 @@ namespace testudo___implementation {
           : string());
     }
 
+    string typeset_nanoseconds(double ns) {
+      ostringstream oss;
+      oss << fixed << setprecision(1) << ns << " ns";
+      return oss.str();
+    }
+
+    // the median times of a benchmark, and the relative change and its
+    // p-value
+    pair<string, string> typeset_benchmark(track_element const &s,
+                                           track_element const &t) {
+      double s_median=median(s.samples), t_median=median(t.samples);
+      ostringstream oss;
+      oss << typeset_nanoseconds(t_median) << ", "
+          << showpos << fixed << setprecision(1)
+          << 100.*(t_median-s_median)/s_median << "%"
+          << noshowpos << defaultfloat << setprecision(2)
+          << ", p=" << mann_whitney_p_value(s.samples, t.samples);
+      return {typeset_nanoseconds(s_median), oss.str()};
+    }
+
     void output_track(ostream &os, track_summary const &ts,
                       unsigned max_line_length,
                       bool bw) {
@@ -98,7 +125,8 @@ namespace testudo___implementation {
       if (ts.deleted_good.empty() and ts.deleted_wrong.empty()
           and ts.new_good.empty() and ts.new_wrong.empty()
           and ts.wrong_to_good.empty() and ts.good_to_wrong.empty()
-          and ts.with_data_changed.empty())
+          and ts.with_data_changed.empty()
+          and ts.faster.empty() and ts.slower.empty())
         typeset->no_changes();
       else {
         for (auto const &[evolution, tracks, is_to]:
@@ -160,14 +188,55 @@ namespace testudo___implementation {
                                    show_label);
             }
           }
+        // benchmarks are good if faster and bad if slower
+        for (auto const &[evolution, tracks, delta]:
+               list<tuple<string,
+                          list<pair<track_element, track_element>> const &,
+                          string>>
+                 {{"faster", ts.faster, "1"},
+                  {"slower", ts.slower, "-1"}})
+          if (not tracks.empty()) {
+            typeset->track_header(evolution, to_string(tracks.size()),
+                                  "", "", delta);
+            for (auto const &[s, t]: tracks) {
+              auto [from, to]=typeset_benchmark(s, t);
+              typeset->track_entry(typeset_address(s.address, t.address),
+                                   s.type, from, to, delta, false);
+            }
+          }
       }
     }
 
-    track_summary diff(track const &source, track const &target,
+    // how to match the elements of both tracks: by a longest common
+    // subsequence, in linear space (the default); by patience diff; or by
+    // the greedy block moves of "shortest_edit()", which also matches moved
+    // elements, but indexes every element of the source and every common
+    // block, so it takes much more memory on large tracks
+    enum class diff_mode_t { lcs, patience, moves };
+
+    edit_t track_edit(vector<interned_id> const &s,
+                      vector<interned_id> const &t,
+                      diff_mode_t mode, size_t min_length) {
+      switch (mode) {
+      case diff_mode_t::lcs:
+        return lcs_to_edit(longest_common_subsequence(s, t));
+      case diff_mode_t::patience:
+        return lcs_to_edit(longest_common_subsequence_patience(s, t));
+      case diff_mode_t::moves: return shortest_edit(s, t, min_length);
+      default: throw runtime_error("unknown diff mode");
+      }
+    }
+
+    track_summary diff(track_columns const &source,
+                       track_columns const &target,
+                       double significance_level,
+                       diff_mode_t mode,
                        std::size_t min_length=1) {
-      auto track_edit=shortest_edit(source, target, min_length);
-      auto table=edit_to_table(track_edit, source.size(), target.size());
-      return track_table_to_summary(source, target, table);
+      auto [s, t]=intern(source, target);
+      auto edit=track_edit(s, t, mode, min_length);
+      auto table=edit_to_table(edit, source.size(), target.size());
+      return
+        track_table_to_summary(source, target, table, significance_level);
     }
 
   }
@@ -175,12 +244,29 @@ namespace testudo___implementation {
   void testudo_diff(opts_t opts) {
     bool bw=false;
     unsigned max_line_length=default_max_line_length;
+    double significance_level=.01;
+    auto mode=diff_mode_t::lcs;
     string source_filename, target_filename;
     while (opts) {
       if (opts.opt("-b"))
         bw=true;
       else if (auto w=opts.opt_arg("-w"))
         max_line_length=stoi(w);
+      else if (auto a=opts.opt_arg("-a"))
+        significance_level=stod(a);
+      else if (auto m=opts.opt_arg("-m")) {
+        if (m==string("lcs"))
+          mode=diff_mode_t::lcs;
+        else if (m==string("patience"))
+          mode=diff_mode_t::patience;
+        else if (m==string("moves"))
+          mode=diff_mode_t::moves;
+        else {
+          cerr << opts.executable << ": unknown diff mode \"" << m << "\""
+               << endl;
+          exit(1);
+        }
+      }
       else {
         if (source_filename.empty())
           source_filename=opts.arg();
@@ -197,10 +283,13 @@ namespace testudo___implementation {
       exit(1);
     }
     auto
-      source=read_track(source_filename),
-      target=read_track(target_filename);
+      source=read_track_file(source_filename),
+      target=read_track_file(target_filename);
 
-    output_track(cout, diff(source, target, 1), max_line_length, bw);
+    output_track(cout,
+                 diff(source.columns, target.columns, significance_level,
+                      mode, 1),
+                 max_line_length, bw);
   }
 
 }
@@ -341,6 +430,89 @@ namespace testudo___implementation::diff_implementation {
   }
 
 
+  edit_t lcs_to_edit(lcs_t const &lcs) {
+    edit_t result;
+    size_t i=0;
+    for (size_t k=0; k<lcs.size(); ) {
+      size_t l=0;
+      char c=lcs[k];
+      for (; (k<lcs.size()) and (lcs[k]==c); ++k)
+        ++l;
+      if (c=='c') {
+        result+="m"+to_string(l)+":"+to_string(i)+".";
+        i+=l;
+      }
+      else if (c=='b')
+        result+="w"+to_string(l)+".";
+      else
+        i+=l;
+    }
+    return result;
+  }
+
+  namespace {
+
+    // the fields the diff needs from element "i" of a track, whether it's
+    // kept as elements or in columns
+
+    string_view type_of(track const &t, size_t i) { return t[i].type; }
+    string_view type_of(track_columns const &t, size_t i) { return t.type[i]; }
+    crc64_t id_of(track const &t, size_t i) { return t[i].id; }
+    crc64_t id_of(track_columns const &t, size_t i) { return t.id[i]; }
+    TestStats const &stats_of(track const &t, size_t i) { return t[i].stats; }
+    TestStats const &stats_of(track_columns const &t, size_t i)
+      { return t.stats[i]; }
+    vector<double> samples_of(track const &t, size_t i)
+      { return t[i].samples; }
+    vector<double> samples_of(track_columns const &t, size_t i) {
+      return {t.samples.begin()+ptrdiff_t(t.sample_begin[i]),
+              t.samples.begin()+ptrdiff_t(t.sample_begin[i+1])};
+    }
+    track_element element_of(track const &t, size_t i) { return t[i]; }
+    track_element element_of(track_columns const &t, size_t i)
+      { return t.element(i); }
+
+    template <typename Track>
+    interned_tracks intern_tracks(Track const &source, Track const &target) {
+      // elements are looked up by CRC, and the type is only compared among
+      // those with the same CRC; the types are views into the tracks
+      unordered_map<crc64_t, vector<pair<string_view, interned_id>>> ids;
+      uint32_t n_ids=0;
+      auto intern_element=
+        [&](Track const &t, size_t i) {
+          auto type=type_of(t, i);
+          auto &same_crc=ids[id_of(t, i)];
+          for (auto const &[same_crc_type, id]: same_crc)
+            if (same_crc_type==type)
+              return id;
+          same_crc.push_back({type, interned_id(n_ids++)});
+          return same_crc.back().second;
+        };
+      interned_tracks result;
+      result.source.reserve(source.size());
+      for (size_t i=0; i<source.size(); ++i)
+        result.source.push_back(intern_element(source, i));
+      result.target.reserve(target.size());
+      for (size_t j=0; j<target.size(); ++j)
+        result.target.push_back(intern_element(target, j));
+      return result;
+    }
+
+  }
+
+  interned_tracks intern(track const &source, track const &target)
+    { return intern_tracks(source, target); }
+
+  interned_tracks intern(track_columns const &source,
+                         track_columns const &target)
+    { return intern_tracks(source, target); }
+
+  ostream &operator<<(ostream &os, vector<interned_id> const &ids) {
+    for (auto id: ids)
+      os << static_cast<uint32_t>(id) << " ";
+    return os;
+  }
+
   bool operator<(track_element const &a, track_element const &b) {
 #define compare_field(f) if (a.f not_eq b.f) return a.f<b.f
     // we don't look at the address or at the stats, because they may change
@@ -412,6 +584,20 @@ namespace testudo___implementation::diff_implementation {
                               +" parsing track");
         e.stats={n_stats[0], n_stats[1], n_stats[2]};
       }
+      if (e.type[0]=='b') { // benchmark
+        // "samples" is e.g. "s-12.5,13.0,12.7"
+        if (words.empty() or (words.front().substr(0, 2) not_eq "s-"))
+          throw runtime_error("invalid line "+to_string(line_n)
+                              +" parsing track");
+        istringstream isssamples(words.front().substr(2));
+        words.pop_front();
+        string sample;
+        while (getline(isssamples, sample, ','))
+          e.samples.push_back(stod(sample));
+        if (e.samples.empty())
+          throw runtime_error("invalid line "+to_string(line_n)
+                              +" parsing track");
+      }
       if (not words.empty())
         throw runtime_error("invalid line "+to_string(line_n)
                             +" parsing track");
@@ -420,6 +606,272 @@ namespace testudo___implementation::diff_implementation {
     return t;
   }
 
+  track_element track_columns::element(size_t i) const {
+    return {string(address[i]), string(type[i]), id[i], stats[i],
+            {samples.begin()+ptrdiff_t(sample_begin[i]),
+             samples.begin()+ptrdiff_t(sample_begin[i+1])}};
+  }
+
+  track track_columns::to_track() const {
+    track t;
+    t.reserve(size());
+    for (size_t i=0; i<size(); ++i)
+      t.push_back(element(i));
+    return t;
+  }
+
+  void track_columns::append(track_columns const &other) {
+    address.insert(address.end(), other.address.begin(), other.address.end());
+    type.insert(type.end(), other.type.begin(), other.type.end());
+    id.insert(id.end(), other.id.begin(), other.id.end());
+    stats.insert(stats.end(), other.stats.begin(), other.stats.end());
+    auto offset=samples.size();
+    samples.insert(samples.end(), other.samples.begin(), other.samples.end());
+    for (auto b=other.sample_begin.begin()+1; b not_eq other.sample_begin.end();
+         ++b)
+      sample_begin.push_back(offset+*b);
+  }
+
+  namespace {
+
+    bool is_space(char c)
+      { return (c==' ') or ((c>='\t') and (c<='\r')); }
+
+    // the whitespace-separated words of a line, as "istream >> string"
+    // reads them
+    class words_t {
+    public:
+      words_t(string_view line) : line(line) { pop_front(); }
+      bool empty() const { return word.empty(); }
+      string_view front() const { return word; }
+      void pop_front() {
+        size_t begin=0;
+        while ((begin<line.size()) and is_space(line[begin]))
+          ++begin;
+        size_t end=begin;
+        while ((end<line.size()) and not is_space(line[end]))
+          ++end;
+        word=line.substr(begin, end-begin);
+        line.remove_prefix(end);
+      }
+    private:
+      string_view line, word;
+    };
+
+    // parse the lines in "text.substr(begin, end-begin)"
+    track_columns parse_track_chunk(string_view text,
+                                    size_t begin, size_t end) {
+      track_columns t;
+      auto n_lines=size_t(count(text.begin()+ptrdiff_t(begin),
+                                text.begin()+ptrdiff_t(end), '\n'))+1;
+      t.address.reserve(n_lines);
+      t.type.reserve(n_lines);
+      t.id.reserve(n_lines);
+      t.stats.reserve(n_lines);
+      t.sample_begin.reserve(n_lines+1);
+      size_t line_begin=begin;
+      // only computed for errors, since it needs counting all the lines
+      // before, including those in other chunks
+      auto invalid=
+        [&text, &line_begin](string const &what) {
+          auto line_n=
+            1+count(text.begin(), text.begin()+ptrdiff_t(line_begin), '\n');
+          return runtime_error(what+" "+to_string(line_n)+" parsing track");
+        };
+      for (; line_begin<end; ) {
+        auto line_end=min(text.find('\n', line_begin), end);
+        auto line=text.substr(line_begin, line_end-line_begin);
+        if (not line.empty()) {
+          words_t words(line);
+          if (words.empty())
+            throw runtime_error("empty line parsing track");
+          string_view address;
+          if (words.front()[0]=='[') {
+            if (words.front().back() not_eq ']')
+              throw runtime_error("invalid address parsing track");
+            address=words.front().substr(1, words.front().size()-2);
+            words.pop_front();
+          }
+          if (words.empty())
+            throw invalid("invalid line");
+          auto type=words.front();
+          words.pop_front();
+          crc64_t id=0;
+          if (not words.empty()) {
+            auto w=words.front();
+            if (not ((w[0]=='[') and (w.back()==']')))
+              throw runtime_error("invalid ID parsing track: \""+string(w)
+                                  +"\"");
+            id=hex_to<crc64_t>(w.substr(1, w.size()-2));
+            words.pop_front();
+          }
+          integer n_stats[3]={0, 0, 0};
+          if ((type[0]=='c') or (type[0]=='e')) { // check or error
+            // e.g. "r-23-2-0"
+            auto w=words.empty() ? string_view() : words.front();
+            if (w.substr(0, 2) not_eq "r-")
+              throw invalid("invalid line");
+            w.remove_prefix(1);
+            for (auto &n: n_stats) {
+              if (w.empty() or (w[0] not_eq '-'))
+                throw invalid("invalid line");
+              auto [p, ec]=from_chars(w.data()+1, w.data()+w.size(), n);
+              if (ec not_eq errc())
+                throw invalid("invalid line");
+              w.remove_prefix(size_t(p-w.data()));
+            }
+            if (not w.empty())
+              throw invalid("invalid line");
+            words.pop_front();
+          }
+          if (type[0]=='b') { // benchmark
+            // e.g. "s-12.5,13.0,12.7"
+            if (words.empty() or (words.front().substr(0, 2) not_eq "s-"))
+              throw invalid("invalid line");
+            auto w=words.front().substr(2);
+            words.pop_front();
+            auto n_samples=t.samples.size();
+            while (not w.empty()) {
+              auto sample=w.substr(0, min(w.find(','), w.size()));
+              double value;
+              if (from_chars(sample.data(), sample.data()+sample.size(),
+                             value).ec not_eq errc())
+                throw invalid("invalid line");
+              t.samples.push_back(value);
+              w.remove_prefix(min(sample.size()+1, w.size()));
+            }
+            if (t.samples.size()==n_samples)
+              throw invalid("invalid line");
+          }
+          if (not words.empty())
+            throw invalid("invalid line");
+          t.address.push_back(address);
+          t.type.push_back(type);
+          t.id.push_back(id);
+          t.stats.push_back({n_stats[0], n_stats[1], n_stats[2]});
+          t.sample_begin.push_back(t.samples.size());
+        }
+        line_begin=line_end+1;
+      }
+      return t;
+    }
+
+  }
+
+  track_columns parse_track_columns(string_view text, unsigned n_chunks) {
+    // chunk boundaries are moved forward to the next line beginning
+    vector<size_t> bounds{0};
+    for (unsigned i=1; i<max(n_chunks, 1u); ++i) {
+      auto bound=max(text.size()*i/n_chunks, bounds.back());
+      auto nl=text.find('\n', bound);
+      bounds.push_back((nl==string_view::npos) ? text.size() : nl+1);
+    }
+    bounds.push_back(text.size());
+    vector<track_columns> chunks(bounds.size()-1);
+    vector<exception_ptr> errors(chunks.size());
+    vector<thread> threads;
+    for (size_t i=0; i<chunks.size(); ++i)
+      threads.emplace_back(
+        [&, i] {
+          try {
+            chunks[i]=parse_track_chunk(text, bounds[i], bounds[i+1]);
+          }
+          catch (...) {
+            errors[i]=current_exception();
+          }
+        });
+    for (auto &t: threads)
+      t.join();
+    // the first error in the text is the one reported
+    for (auto const &e: errors)
+      if (e)
+        rethrow_exception(e);
+    // each chunk is released as soon as it's appended, so that the text
+    // isn't held in columns twice
+    size_t n_lines=0, n_samples=0;
+    for (auto const &c: chunks) {
+      n_lines+=c.size();
+      n_samples+=c.samples.size();
+    }
+    track_columns result=move(chunks.front());
+    result.address.reserve(n_lines);
+    result.type.reserve(n_lines);
+    result.id.reserve(n_lines);
+    result.stats.reserve(n_lines);
+    result.samples.reserve(n_samples);
+    result.sample_begin.reserve(n_lines+1);
+    for (size_t i=1; i<chunks.size(); ++i) {
+      result.append(chunks[i]);
+      chunks[i]={};
+    }
+    return result;
+  }
+
+  namespace {
+
+    // a read-only memory mapping of a whole regular file
+    class mapped_file_t {
+    public:
+      mapped_file_t(int fd, size_t size) : size(size) {
+        if (size>0) {
+          data=mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+          if (data==MAP_FAILED)
+            throw runtime_error(string("mmap() error: ")+strerror(errno));
+          madvise(data, size, MADV_SEQUENTIAL);
+        }
+      }
+      ~mapped_file_t() {
+        if (size>0)
+          munmap(data, size);
+      }
+      mapped_file_t(mapped_file_t const &)=delete;
+      mapped_file_t &operator=(mapped_file_t const &)=delete;
+      string_view text() const
+        { return {static_cast<char const *>(data), size}; }
+    private:
+      void *data=nullptr;
+      size_t size;
+    };
+
+    // below this, a track isn't worth parsing in several threads
+    size_t const min_parallel_chunk_size=size_t(1) << 22;
+
+  }
+
+  track_file read_track_file(string const &file_name) {
+    track_file result;
+    int fd=open(file_name.c_str(), O_RDONLY);
+    struct stat st;
+    if ((fd<0) or (fstat(fd, &st) not_eq 0) or not S_ISREG(st.st_mode)) {
+      if (fd>=0)
+        close(fd);
+      ifstream file(file_name);
+      auto text=make_shared<string>(istreambuf_iterator<char>(file),
+                                    istreambuf_iterator<char>());
+      result.columns=parse_track_columns(*text);
+      result.text=move(text);
+      return result;
+    }
+    try {
+      auto mapped=make_shared<mapped_file_t>(fd, size_t(st.st_size));
+      close(fd);
+      fd=-1;
+      auto text=mapped->text();
+      auto n_chunks=
+        static_cast<unsigned>(
+          min<size_t>(max(1u, thread::hardware_concurrency()),
+                      text.size()/min_parallel_chunk_size+1));
+      result.columns=parse_track_columns(text, n_chunks);
+      result.text=move(mapped);
+      return result;
+    }
+    catch (...) {
+      if (fd>=0)
+        close(fd);
+      throw;
+    }
+  }
+
   ostream &operator<<(ostream &os, track_element const &e) {
     if (not e.address.empty())
       os << "[" << typeset_address(e.address) << "] ";
@@ -430,6 +882,11 @@ namespace testudo___implementation::diff_implementation {
       +"-"+to_string(e.stats.n_errors());
     if ((e.type[0]=='c') or (e.type[0]=='e')) // check or error
       os << " " << stats;
+    if (e.type[0]=='b') { // benchmark
+      os << " s-";
+      for (auto s=e.samples.begin(); s not_eq e.samples.end(); ++s)
+        os << ((s==e.samples.begin()) ? "" : ",") << *s;
+    }
     return os;
   }
 
@@ -448,43 +905,122 @@ namespace testudo___implementation::diff_implementation {
 
   }
 
-  track_summary track_table_to_summary(track const &source,
-                                       track const &target,
-                                       edit_table const &table) {
-    track_summary ts;
-
-    for (auto i: table.source_disappeared) {
-      auto const &te=source[i];
-      if ((te.type[0]=='c') or (te.type[0]=='e')) // check or error
-        (is_good(te.stats) ? ts.deleted_good : ts.deleted_wrong).push_back(te);
-    }
-    for (auto j: table.target_new) {
-      auto const &e=target[j];
-      if ((e.type[0]=='c') or (e.type[0]=='e')) // check or error
-        (is_error(e.stats) ? ts.new_error
-         : is_good(e.stats) ? ts.new_good
-         : ts.new_wrong)
-          .push_back(e);
+  double mann_whitney_p_value(vector<double> const &a,
+                              vector<double> const &b) {
+    if (a.empty() or b.empty())
+      return 1.;
+    auto n_a=static_cast<double>(a.size()), n_b=static_cast<double>(b.size());
+    // rank the pooled samples, giving tied samples their mean rank
+    vector<pair<double, bool>> pooled; // value, whether it's from "a"
+    for (auto x: a)
+      pooled.push_back({x, true});
+    for (auto x: b)
+      pooled.push_back({x, false});
+    sort(pooled.begin(), pooled.end());
+    double rank_sum_a=0., tie_correction=0.;
+    for (size_t i=0; i<pooled.size(); ) {
+      size_t j=i;
+      while ((j<pooled.size()) and not (pooled[i].first<pooled[j].first))
+        ++j;
+      auto n_tied=static_cast<double>(j-i);
+      double mean_rank=(static_cast<double>(i+j)+1.)/2.; // ranks from 1
+      for (size_t k=i; k<j; ++k)
+        if (pooled[k].second)
+          rank_sum_a+=mean_rank;
+      tie_correction+=n_tied*n_tied*n_tied-n_tied;
+      i=j;
     }
+    double u_a=rank_sum_a-n_a*(n_a+1.)/2.;
+    double n=n_a+n_b;
+    double mean_u=n_a*n_b/2.;
+    double variance_u=n_a*n_b/12.*((n+1.)-tie_correction/(n*(n-1.)));
+    if (not (variance_u>0.)) // all the samples are the same
+      return 1.;
+    // continuity correction
+    double z=max(0., abs(u_a-mean_u)-.5)/sqrt(variance_u);
+    return erfc(z/sqrt(2.));
+  }
+
+  double median(vector<double> v) {
+    if (v.empty())
+      return 0.;
+    auto middle=v.begin()+static_cast<ptrdiff_t>(v.size()/2);
+    nth_element(v.begin(), middle, v.end());
+    if (v.size()%2)
+      return *middle;
+    else
+      return (*middle+*max_element(v.begin(), middle))/2.;
+  }
 
-    for (auto [i, j]: table.source_matches) {
-      auto const &es=source[i], &et=target[j];
-      if ((es.type[0]=='c') or (es.type[0]=='e')) { // check or error
-        if (es.type=="c-with_summary") {
-          if (not (es.stats==et.stats))
-            ts.with_data_changed.push_back({es, et});
-          // FIXME: but we're missing changes that leave the summary unchanged
+  namespace {
+
+    template <typename Track>
+    track_summary table_to_summary(Track const &source, Track const &target,
+                                   edit_table const &table,
+                                   double significance_level) {
+      track_summary ts;
+
+      // only the elements reported are copied out of the tracks
+      for (auto i: table.source_disappeared) {
+        auto type=type_of(source, i);
+        auto const &stats=stats_of(source, i);
+        if ((type[0]=='c') or (type[0]=='e')) // check or error
+          (is_good(stats) ? ts.deleted_good : ts.deleted_wrong)
+            .push_back(element_of(source, i));
+      }
+      for (auto j: table.target_new) {
+        auto type=type_of(target, j);
+        auto const &stats=stats_of(target, j);
+        if ((type[0]=='c') or (type[0]=='e')) // check or error
+          (is_error(stats) ? ts.new_error
+           : is_good(stats) ? ts.new_good
+           : ts.new_wrong)
+            .push_back(element_of(target, j));
+      }
+
+      for (auto [i, j]: table.source_matches) {
+        auto type=type_of(source, i);
+        auto const &s_stats=stats_of(source, i), &t_stats=stats_of(target, j);
+        if ((type[0]=='c') or (type[0]=='e')) { // check or error
+          if (type=="c-with_summary") {
+            if (not (s_stats==t_stats))
+              ts.with_data_changed.push_back({element_of(source, i),
+                                              element_of(target, j)});
+            // FIXME: but we're missing changes that leave the summary
+            // unchanged
+          }
+          else if (is_good(s_stats) not_eq is_good(t_stats)) {
+            (is_error(t_stats) ? ts.to_error
+             : is_good(s_stats) ? ts.good_to_wrong
+             : ts.wrong_to_good)
+              .push_back({element_of(source, i), element_of(target, j)});
+          }
         }
-        else if (is_good(es.stats) not_eq is_good(et.stats)) {
-          (is_error(et.stats) ? ts.to_error
-           : is_good(es.stats) ? ts.good_to_wrong
-           : ts.wrong_to_good)
-            .push_back({es, et});
+        else if (type[0]=='b') { // benchmark
+          auto s_samples=samples_of(source, i), t_samples=samples_of(target, j);
+          if (mann_whitney_p_value(s_samples, t_samples)<significance_level)
+            ((median(t_samples)<median(s_samples)) ? ts.faster : ts.slower)
+              .push_back({element_of(source, i), element_of(target, j)});
         }
       }
+
+      return ts;
     }
 
-    return ts;
+  }
+
+  track_summary track_table_to_summary(track const &source,
+                                       track const &target,
+                                       edit_table const &table,
+                                       double significance_level) {
+    return table_to_summary(source, target, table, significance_level);
+  }
+
+  track_summary track_table_to_summary(track_columns const &source,
+                                       track_columns const &target,
+                                       edit_table const &table,
+                                       double significance_level) {
+    return table_to_summary(source, target, table, significance_level);
   }
 
   ostream &operator<<(ostream &os, track_summary const &ts) {
@@ -22,11 +22,16 @@
 #include "testudo_stats.h"
 #include "crc.h"
 #include <string>
+#include <string_view>
 #include <random>
 #include <cassert>
 #include <unordered_map>
 #include <map>
 #include <set>
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <cstdint>
 
 #define DO_TRACE
 #include "trace.h"
@@ -129,9 +134,242 @@ namespace testudo___implementation {
       return result;
     }
 
+    // the previous implementation keeps the whole "v" vector for every edit
+    // distance "d", which takes O((n+m)·d) memory; the following one is the
+    // linear-space variant from Myers' paper (section 4b): it looks for the
+    // "middle snake" of an optimal path, going forward from the start and
+    // backward from the end at the same time, until the paths overlap, and
+    // then it solves, recursively, the subproblems before and after the
+    // overlapping point, so it takes O(n+m) memory; the common prefix and
+    // suffix are matched beforehand, which is both a fast path for the
+    // usual case of few changes, and what guarantees the subproblems are
+    // smaller
+    namespace lcs_linear_implementation {
+
+      using integer=std::make_signed_t<std::size_t>;
+
+      // a point where an optimal path from (0, 0) to (n, m) passes, found
+      // through the middle snake, with 0<x+y<n+m; it must be called with
+      // different first and last elements
+      template <typename Container>
+      std::pair<integer, integer> split(Container const &a, integer a_begin,
+                                        Container const &b, integer b_begin,
+                                        integer n, integer m) {
+        integer max_d=(n+m+1)/2, offset=max_d+1;
+        // forward: "v_f[offset+k]" is the furthest "x" on diagonal "k";
+        // backward: "v_b[offset+k]" is the furthest "x" on diagonal "k",
+        // counting from the end
+        std::vector<integer> v_f(2*offset+1, -1), v_b(2*offset+1, -1);
+        v_f[offset+1]=v_b[offset+1]=0;
+        integer delta=n-m;
+        bool odd=(delta%2 not_eq 0);
+        for (integer d=0; d<=max_d; ++d) {
+          for (integer k=-d; k<=d; k+=2) {
+            integer x=
+              ((k==-d) or ((k not_eq d) and (v_f[offset+k-1]<v_f[offset+k+1])))
+              ? v_f[offset+k+1]
+              : v_f[offset+k-1]+1;
+            integer y=x-k;
+            if ((x>n) or (y>m) or (y<0))
+              continue; // off the grid
+            while ((x<n) and (y<m) and (a[a_begin+x]==b[b_begin+y]))
+              ++x, ++y;
+            v_f[offset+k]=x;
+            integer k_b=delta-k;
+            if (odd and (k_b>=-(d-1)) and (k_b<=d-1)
+                and (v_b[offset+k_b]>=0)
+                and (x+v_b[offset+k_b]>=n))
+              return {x, y};
+          }
+          for (integer k=-d; k<=d; k+=2) {
+            integer x=
+              ((k==-d) or ((k not_eq d) and (v_b[offset+k-1]<v_b[offset+k+1])))
+              ? v_b[offset+k+1]
+              : v_b[offset+k-1]+1;
+            integer y=x-k;
+            if ((x>n) or (y>m) or (y<0))
+              continue; // off the grid
+            while ((x<n) and (y<m)
+                   and (a[a_begin+n-x-1]==b[b_begin+m-y-1]))
+              ++x, ++y;
+            v_b[offset+k]=x;
+            integer k_f=delta-k;
+            if ((not odd) and (k_f>=-d) and (k_f<=d)
+                and (v_f[offset+k_f]>=0)
+                and (v_f[offset+k_f]+x>=n))
+              return {n-x, m-y};
+          }
+        }
+        assert(false); // the paths always overlap by "d==max_d"
+        return {n, m};
+      }
+
+      template <typename Container>
+      void lcs(Container const &a, integer a_begin, integer a_end,
+               Container const &b, integer b_begin, integer b_end,
+               lcs_t &result) {
+        // common prefix and suffix
+        integer prefix=0;
+        while ((a_begin+prefix<a_end) and (b_begin+prefix<b_end)
+               and (a[a_begin+prefix]==b[b_begin+prefix]))
+          ++prefix;
+        result.append(prefix, 'c');
+        a_begin+=prefix;
+        b_begin+=prefix;
+        integer suffix=0;
+        while ((a_begin<a_end-suffix) and (b_begin<b_end-suffix)
+               and (a[a_end-suffix-1]==b[b_end-suffix-1]))
+          ++suffix;
+        a_end-=suffix;
+        b_end-=suffix;
+        if (a_begin==a_end)
+          result.append(b_end-b_begin, 'b');
+        else if (b_begin==b_end)
+          result.append(a_end-a_begin, 'a');
+        else {
+          auto [x, y]=split(a, a_begin, b, b_begin,
+                            a_end-a_begin, b_end-b_begin);
+          lcs(a, a_begin, a_begin+x, b, b_begin, b_begin+y, result);
+          lcs(a, a_begin+x, a_end, b, b_begin+y, b_end, result);
+        }
+        result.append(suffix, 'c');
+      }
+
+      // the subproblems may leave a 'b' before an 'a' in a run of
+      // differences, which is as valid, but not in the canonical form
+      inline void canonicalize(lcs_t &result) {
+        for (std::size_t i=0; i<result.size(); ) {
+          std::size_t j=i, n_a=0;
+          for (; (j<result.size()) and (result[j] not_eq 'c'); ++j)
+            n_a+=(result[j]=='a');
+          std::fill(result.begin()+i, result.begin()+i+n_a, 'a');
+          std::fill(result.begin()+i+n_a, result.begin()+j, 'b');
+          i=(j<result.size()) ? j+1 : j;
+        }
+      }
+
+    }
+
+    template <typename Container>
+    lcs_t longest_common_subsequence_linear(
+        Container const &a, Container const &b) {
+      using namespace lcs_linear_implementation;
+      lcs_t result;
+      lcs(a, 0, integer(a.size()), b, 0, integer(b.size()), result);
+      canonicalize(result);
+      return result;
+    }
+
     template <typename Container>
     lcs_t longest_common_subsequence(Container const &a, Container const &b) {
-      auto result=longest_common_subsequence_debug(a, b);
+      auto result=longest_common_subsequence_linear(a, b);
+      assert(check_common_subsequence(a, b, result));
+      return result;
+    }
+
+    // patience diff: the elements that appear exactly once in each sequence
+    // are matched first, keeping the longest increasing subsequence of those
+    // matches (found by patience sorting) as anchors; then, the same is done
+    // recursively between anchors, and the regions with no unique elements
+    // are solved with the linear-space algorithm above; the result isn't
+    // always a longest common subsequence, but it's usually closer to what a
+    // human would match, and it's fast when the sequences have many unique
+    // elements, as tracks do; the elements must be hashable
+    namespace lcs_patience_implementation {
+
+      using lcs_linear_implementation::integer;
+
+      template <typename Container>
+      void lcs(Container const &a, integer a_begin, integer a_end,
+               Container const &b, integer b_begin, integer b_end,
+               lcs_t &result) {
+        // common prefix and suffix
+        integer prefix=0;
+        while ((a_begin+prefix<a_end) and (b_begin+prefix<b_end)
+               and (a[a_begin+prefix]==b[b_begin+prefix]))
+          ++prefix;
+        result.append(prefix, 'c');
+        a_begin+=prefix;
+        b_begin+=prefix;
+        integer suffix=0;
+        while ((a_begin<a_end-suffix) and (b_begin<b_end-suffix)
+               and (a[a_end-suffix-1]==b[b_end-suffix-1]))
+          ++suffix;
+        a_end-=suffix;
+        b_end-=suffix;
+
+        // occurrences and (last) position of every element in each range
+        struct occurrences_t { integer n_a=0, n_b=0, i_a=0, i_b=0; };
+        std::unordered_map<typename Container::value_type, occurrences_t>
+          occurrences;
+        for (integer i=a_begin; i<a_end; ++i) {
+          auto &o=occurrences[a[i]];
+          ++o.n_a;
+          o.i_a=i;
+        }
+        for (integer j=b_begin; j<b_end; ++j) {
+          auto it=occurrences.find(b[j]);
+          if (it not_eq occurrences.end()) {
+            ++it->second.n_b;
+            it->second.i_b=j;
+          }
+        }
+        // unique matches, in "b" order
+        std::vector<std::pair<integer, integer>> unique;
+        for (integer j=b_begin; j<b_end; ++j) {
+          auto it=occurrences.find(b[j]);
+          if ((it not_eq occurrences.end())
+              and (it->second.n_a==1) and (it->second.n_b==1))
+            unique.push_back({it->second.i_a, j});
+        }
+
+        if (unique.empty())
+          lcs_linear_implementation::lcs(a, a_begin, a_end,
+                                         b, b_begin, b_end, result);
+        else {
+          // longest increasing subsequence of the "a" positions: "piles"
+          // keeps, for each length, the index in "unique" of the match with
+          // the smallest "a" position that ends a subsequence that long
+          std::vector<std::size_t> piles, previous(unique.size());
+          for (std::size_t k=0; k<unique.size(); ++k) {
+            auto pile=
+              std::lower_bound(
+                piles.begin(), piles.end(), unique[k].first,
+                [&unique](std::size_t p, integer i)
+                  { return unique[p].first<i; });
+            previous[k]=(pile==piles.begin()) ? k : *(pile-1);
+            if (pile==piles.end())
+              piles.push_back(k);
+            else
+              *pile=k;
+          }
+          std::vector<std::pair<integer, integer>> anchors;
+          for (std::size_t k=piles.back(); ; k=previous[k]) {
+            anchors.push_back(unique[k]);
+            if (previous[k]==k)
+              break;
+          }
+          std::reverse(anchors.begin(), anchors.end());
+          for (auto [i, j]: anchors) {
+            lcs(a, a_begin, i, b, b_begin, j, result);
+            result+='c';
+            a_begin=i+1;
+            b_begin=j+1;
+          }
+          lcs(a, a_begin, a_end, b, b_begin, b_end, result);
+        }
+        result.append(suffix, 'c');
+      }
+
+    }
+
+    template <typename Container>
+    lcs_t longest_common_subsequence_patience(
+        Container const &a, Container const &b) {
+      using namespace lcs_patience_implementation;
+      lcs_t result;
+      lcs(a, 0, integer(a.size()), b, 0, integer(b.size()), result);
+      lcs_linear_implementation::canonicalize(result);
       assert(check_common_subsequence(a, b, result));
       return result;
     }
@@ -362,6 +600,10 @@ namespace testudo___implementation {
       return result;
     }
 
+    // an edit, as the ones "shortest_edit()" produces, with the common
+    // elements of an LCS as moves in order
+    edit_t lcs_to_edit(lcs_t const &);
+
     struct edit_table {
       std::vector<std::size_t>
         source_disappeared, // ordered by source index
@@ -380,15 +622,61 @@ namespace testudo___implementation {
       std::string type;
       cyclic_redundancy_check::crc64_t id;
       testudo::TestStats stats;
+      std::vector<double> samples={}; // for benchmarks, in nanoseconds
     };
     bool operator<(track_element const &, track_element const &);
     std::ostream &operator<<(std::ostream &, track_element const &);
 
     using track=std::vector<track_element>;
 
+    // the tracks, with each element replaced by a dense integer id, the same
+    // for equivalent elements (same type and CRC), so that the diff
+    // algorithms compare integers instead of strings
+    enum class interned_id : std::uint32_t { };
+    std::ostream &operator<<(std::ostream &, std::vector<interned_id> const &);
+    struct interned_tracks {
+      std::vector<interned_id> source, target;
+    };
+    interned_tracks intern(track const &source, track const &target);
+
     track parse_track(std::istream &is);
     std::ostream &operator<<(std::ostream &, track const &);
 
+    // a track parsed in place, with each field kept in its own column; the
+    // addresses and types are views into the parsed text, which must outlive
+    // the columns
+    struct track_columns {
+      std::vector<std::string_view> address, type;
+      std::vector<cyclic_redundancy_check::crc64_t> id;
+      std::vector<testudo::TestStats> stats;
+      // the samples of element "i" are those in the range
+      // "[sample_begin[i], sample_begin[i+1])" of "samples"
+      std::vector<double> samples;
+      std::vector<std::size_t> sample_begin{0};
+      std::size_t size() const { return type.size(); }
+      track_element element(std::size_t i) const;
+      track to_track() const;
+      void append(track_columns const &);
+    };
+    interned_tracks intern(track_columns const &source,
+                           track_columns const &target);
+    // parse the text of a track, in "n_chunks" chunks of whole lines, each
+    // one in its own thread; the result (and the errors) are the same as
+    // "parse_track()"'s
+    track_columns parse_track_columns(std::string_view text,
+                                      unsigned n_chunks=1);
+
+    // a track read from a file: its columns, and whatever keeps alive the
+    // text they view
+    struct track_file {
+      std::shared_ptr<void const> text;
+      track_columns columns;
+    };
+    // read a track file; a regular file is memory-mapped, and parsed in
+    // place, in parallel if it's large; anything else (e.g., a pipe) is read
+    // into memory with an "ifstream", and parsed from there
+    track_file read_track_file(std::string const &file_name);
+
     struct track_summary {
       std::list<track_element>
         deleted_good,
@@ -400,12 +688,28 @@ namespace testudo___implementation {
         wrong_to_good,
         good_to_wrong,
         to_error,
-        with_data_changed;
+        with_data_changed,
+        faster, // benchmarks
+        slower;
     };
 
+    // two-sided p-value of the Mann-Whitney U test (normal approximation,
+    // with tie correction) for the samples "a" and "b" coming from the same
+    // distribution
+    double mann_whitney_p_value(std::vector<double> const &a,
+                                std::vector<double> const &b);
+    double median(std::vector<double> v);
+
+    // a matched benchmark is faster or slower if its samples are different
+    // with a p-value below "significance_level"
     track_summary track_table_to_summary(track const &source,
                                          track const &target,
-                                         edit_table const &);
+                                         edit_table const &,
+                                         double significance_level=.01);
+    track_summary track_table_to_summary(track_columns const &source,
+                                         track_columns const &target,
+                                         edit_table const &,
+                                         double significance_level=.01);
 
     std::ostream &operator<<(std::ostream &os, track_summary const &);
 
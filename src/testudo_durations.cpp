@@ -0,0 +1,52 @@
+// Copyright © 2020-2023 Miguel González Cuadrado <mgcuadrado@gmail.com>
+
+// This file is part of Testudo.
+
+//     Testudo is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+
+//     Testudo is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+
+//     You should have received a copy of the GNU General Public License
+//     along with Testudo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "testudo_durations.h"
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+namespace testudo___implementation {
+
+  using namespace std;
+
+  durations_t read_durations(string filename) {
+    durations_t result;
+    ifstream is(filename);
+    double duration;
+    string name;
+    while (is >> duration) {
+      is.ignore(1); // the space
+      getline(is, name);
+      result[name]=duration;
+    }
+    if (is.bad() or not (is.eof() or result.empty()))
+      throw runtime_error("wrong format in durations file \""+filename+"\"");
+    return result;
+  }
+
+  void write_durations(string filename, durations_t const &durations) {
+    ofstream os(filename);
+    // benchmark times can be a few nanoseconds, hence significant digits
+    os << setprecision(9);
+    for (auto const &[name, duration]: durations)
+      os << duration << ' ' << name << '\n';
+    if (not os)
+      throw runtime_error("couldn't write durations file \""+filename+"\"");
+  }
+
+}
@@ -0,0 +1,36 @@
+// Copyright © 2020-2023 Miguel González Cuadrado <mgcuadrado@gmail.com>
+
+// This file is part of Testudo.
+
+//     Testudo is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+
+//     Testudo is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+
+//     You should have received a copy of the GNU General Public License
+//     along with Testudo.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MGCUADRADO_TESTUDO_DURATIONS_HEADER_
+#define MGCUADRADO_TESTUDO_DURATIONS_HEADER_
+
+#include "testudo.h"
+#include <string>
+
+namespace testudo___implementation {
+
+  // durations files keep the durations of test functions from previous runs,
+  // so that later runs can schedule them; they are text files with a line
+  // per test function, with its duration in seconds, a space, and its full
+  // name (up to the end of the line); a missing file reads as no durations;
+  // benchmark baselines use the same format, with benchmark keys as names
+  durations_t read_durations(std::string filename);
+  void write_durations(std::string filename, durations_t const &durations);
+
+}
+
+#endif
@@ -0,0 +1,468 @@
+// Copyright © 2020-2023 Miguel González Cuadrado <mgcuadrado@gmail.com>
+
+// This file is part of Testudo.
+
+//     Testudo is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+
+//     Testudo is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+
+//     You should have received a copy of the GNU General Public License
+//     along with Testudo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "testudo_fork.h"
+#include "testudo_format_record.h"
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <cassert>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+
+namespace testudo___implementation {
+
+  using namespace std;
+
+  namespace {
+
+    using ev=test_format_event_t;
+
+    size_t const no_task=size_t(-1);
+
+    // frames sent from a worker to the parent process: an event, preceded by
+    // the stats so far, or the final stats, when the test function is done
+    char const event_frame='e', done_frame='d';
+
+    void write_all(int fd, void const *data, size_t size) {
+      auto p=static_cast<char const *>(data);
+      while (size>0) {
+        auto n=write(fd, p, size);
+        if (n<0) {
+          if (errno==EINTR)
+            continue;
+          throw runtime_error(string("write() error: ")+strerror(errno));
+        }
+        p+=n;
+        size-=static_cast<size_t>(n);
+      }
+    }
+
+    // false if the other end was closed before "size" bytes could be read
+    bool read_all(int fd, void *data, size_t size) {
+      auto p=static_cast<char *>(data);
+      while (size>0) {
+        auto n=read(fd, p, size);
+        if (n<0) {
+          if (errno==EINTR)
+            continue;
+          throw runtime_error(string("read() error: ")+strerror(errno));
+        }
+        if (n==0)
+          return false;
+        p+=n;
+        size-=static_cast<size_t>(n);
+      }
+      return true;
+    }
+
+    template <typename T>
+    void append_raw(T const &value, string &buffer)
+      { buffer.append(reinterpret_cast<char const *>(&value), sizeof(T)); }
+
+    void append_stats(TestStats const &stats, string &buffer) {
+      append_raw(stats.n_passed(), buffer);
+      append_raw(stats.n_failed(), buffer);
+      append_raw(stats.n_errors(), buffer);
+    }
+
+    bool read_stats(int fd, TestStats &stats) {
+      integer n[3];
+      if (not read_all(fd, n, sizeof(n)))
+        return false;
+      stats=TestStats(n[0], n[1], n[2]);
+      return true;
+    }
+
+    // the test format used in the workers; it sends every event to the
+    // parent process as soon as it's recorded, along with the stats so far,
+    // so that nothing already output is lost if the worker crashes
+    class TestFormatPipe
+      : public TestFormatRecord {
+    public:
+      TestFormatPipe(int fd, TestStats const &stats)
+        : fd(fd), stats(stats) { }
+    protected:
+      void record(test_format_event_t event) override {
+        string encoded;
+        encode(event, encoded);
+        string frame(1, event_frame);
+        append_stats(stats, frame);
+        append_raw(encoded.size(), frame);
+        frame+=encoded;
+        write_all(fd, frame.data(), frame.size());
+      }
+    private:
+      int const fd;
+      TestStats const &stats;
+    };
+
+    // "_exit()" skips the flushing that "exit()" would do, and whatever
+    // test functions wrote to the standard streams would be lost
+    void flush_standard_streams() {
+      cout.flush();
+      cerr.flush();
+      clog.flush();
+      fflush(nullptr);
+    }
+
+    [[noreturn]]
+    void worker_loop(int command_fd, int result_fd,
+                     vector<isolated_test_f_t> const &tests) {
+      try {
+        size_t task;
+        while (read_all(command_fd, &task, sizeof(task))) {
+          TestStats stats;
+          tests.at(task)(
+            {make_shared<TestFormatPipe>(result_fd, stats), {}, stats});
+          string frame(1, done_frame);
+          append_stats(stats, frame);
+          write_all(result_fd, frame.data(), frame.size());
+        }
+        flush_standard_streams();
+        _exit(0);
+      }
+      catch (...) {
+        flush_standard_streams();
+        _exit(1);
+      }
+    }
+
+    struct worker_t {
+      pid_t pid=-1;
+      int command_fd=-1, result_fd=-1;
+      size_t task=no_task;
+      chrono::steady_clock::time_point start={};
+      TestStats stats_so_far={};
+      // "output_begin_*()" events without their "output_end_*()" yet
+      test_format_events_t open_events={};
+    };
+
+    // the file descriptors a worker finds its pipe ends at
+    int const worker_command_fd=3, worker_result_fd=4;
+
+    // the highest open file descriptor, from the entries in
+    // "/proc/self/fd"; this is run in a freshly forked worker, which mustn't
+    // allocate (another thread could have been holding the allocator's lock
+    // when forking), so the entries are read with the bare system call
+    int highest_open_fd() {
+      int const fallback=static_cast<int>(sysconf(_SC_OPEN_MAX))-1;
+#ifdef SYS_getdents64
+      int dir_fd=open("/proc/self/fd", O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+      if (dir_fd<0)
+        return fallback;
+      int result=dir_fd;
+      alignas(8) char buffer[4096];
+      long n;
+      while ((n=syscall(SYS_getdents64, dir_fd, buffer, sizeof(buffer)))>0)
+        for (long pos=0; pos<n;) {
+          // a "struct linux_dirent64": inode (8 bytes), offset (8 bytes),
+          // record length (2 bytes), type (1 byte), and the name
+          unsigned short record_length;
+          memcpy(&record_length, buffer+pos+16, sizeof(record_length));
+          int fd=0;
+          char const *digit=buffer+pos+19;
+          for (; (*digit>='0') and (*digit<='9'); ++digit)
+            fd=fd*10+(*digit-'0');
+          if (digit not_eq buffer+pos+19) // not "." or ".."
+            result=max(result, fd);
+          pos+=record_length;
+        }
+      close(dir_fd);
+      return (n<0) ? fallback : result;
+#else
+      return fallback;
+#endif
+    }
+
+    // close every file descriptor from "first" on; the pipes of workers
+    // spawned by other runs, on other threads, are among them, and keeping
+    // those open would hide those workers' deaths, and the parent process
+    // closing their command pipe, from those runs
+    void close_from(int first) {
+#ifdef SYS_close_range
+      if (syscall(SYS_close_range, first, ~0u, 0u)==0)
+        return;
+#endif
+      for (int fd=first, last=highest_open_fd(); fd<=last; ++fd)
+        close(fd);
+    }
+
+    worker_t spawn_worker(vector<isolated_test_f_t> const &tests) {
+      int command_pipe[2], result_pipe[2];
+      if (pipe(command_pipe) or pipe(result_pipe))
+        throw runtime_error(string("pipe() error: ")+strerror(errno));
+      // otherwise, the worker would inherit any pending output
+      cout.flush();
+      cerr.flush();
+      auto pid=fork();
+      if (pid<0)
+        throw runtime_error(string("fork() error: ")+strerror(errno));
+      if (pid==0) {
+        // move the worker's pipe ends out of the way first, so that moving
+        // them to their final place can't overwrite one with the other
+        int const first_free_fd=worker_result_fd+1;
+        int command_fd=fcntl(command_pipe[0], F_DUPFD, first_free_fd);
+        int result_fd=fcntl(result_pipe[1], F_DUPFD, first_free_fd);
+        if ((command_fd<0) or (result_fd<0)
+            or (dup2(command_fd, worker_command_fd)<0)
+            or (dup2(result_fd, worker_result_fd)<0))
+          _exit(1);
+        close_from(first_free_fd);
+        worker_loop(worker_command_fd, worker_result_fd, tests);
+      }
+      close(command_pipe[0]);
+      close(result_pipe[1]);
+      worker_t worker;
+      worker.pid=pid;
+      worker.command_fd=command_pipe[1];
+      worker.result_fd=result_pipe[0];
+      return worker;
+    }
+
+    void track_open_events(test_format_events_t &open_events,
+                           test_format_event_t const &event) {
+      switch (event.kind) {
+      case ev::output_begin_indent:
+      case ev::output_begin_scope:
+      case ev::output_begin_declare_scope:
+      case ev::output_begin_with:
+      case ev::output_begin_with_results:
+        open_events.push_back(event);
+        break;
+      case ev::output_end_indent:
+      case ev::output_end_scope:
+      case ev::output_end_declare_scope:
+      case ev::output_end_with:
+      case ev::output_end_with_results:
+        if (not open_events.empty())
+          open_events.pop_back();
+        break;
+      default:
+        break;
+      }
+    }
+
+    test_format_event_t closing_event(test_format_event_t const &open_event) {
+      switch (open_event.kind) {
+      case ev::output_begin_indent: return {ev::output_end_indent, {}};
+      case ev::output_begin_scope:
+        return {ev::output_end_scope, open_event.args};
+      case ev::output_begin_declare_scope:
+        return {ev::output_end_declare_scope, {}};
+      case ev::output_begin_with: return {ev::output_end_with, {}};
+      case ev::output_begin_with_results:
+        return {ev::output_end_with_results, {}};
+      default:
+        throw runtime_error("not an opening test format event");
+      }
+    }
+
+    string describe_worker_death(int status) {
+      if (WIFSIGNALED(status)) {
+        int signal_number=WTERMSIG(status);
+        return "test process killed by signal "+to_string(signal_number)
+          +" ("+strsignal(signal_number)+")";
+      }
+      else if (WIFEXITED(status))
+        return "test process exited with status "
+          +to_string(WEXITSTATUS(status));
+      else
+        return "test process died";
+    }
+
+    void close_worker(worker_t &worker) {
+      close(worker.command_fd);
+      close(worker.result_fd);
+      worker.command_fd=worker.result_fd=-1;
+    }
+
+  }
+
+  void run_in_processes(vector<isolated_test_f_t> const &tests,
+                        vector<test_management_t> const &results,
+                        unsigned processes, double timeout,
+                        vector<double> &durations) {
+    assert(tests.size()==results.size());
+    durations.assign(tests.size(), 0.);
+    // writing to a dead worker mustn't kill us; this is done once and for
+    // all, since runs on other threads may be writing to their workers at
+    // any time
+    static auto const sigpipe_ignored=signal(SIGPIPE, SIG_IGN);
+    (void)sigpipe_ignored;
+
+    vector<worker_t> workers;
+    size_t next_task=0;
+    auto dispatch=
+      [&](worker_t &worker) {
+        worker.task=(next_task<tests.size()) ? next_task++ : no_task;
+        worker.stats_so_far={};
+        worker.open_events.clear();
+        worker.start=chrono::steady_clock::now();
+        if (worker.task not_eq no_task)
+          write_all(worker.command_fd, &worker.task, sizeof(worker.task));
+      };
+    auto record_duration=
+      [&](worker_t const &worker) {
+        durations[worker.task]=
+          chrono::duration<double>(chrono::steady_clock::now()-worker.start)
+          .count();
+      };
+
+    // pre-fork the pool of workers
+    for (size_t i=0; i<max(processes, 1u) and i<tests.size(); ++i) {
+      workers.push_back(spawn_worker(tests));
+      dispatch(workers.back());
+    }
+
+    // receive one frame from a busy worker; false if the worker died
+    auto receive=
+      [&](worker_t &worker) {
+        auto const &result=results[worker.task];
+        char frame_type;
+        if (not read_all(worker.result_fd, &frame_type, 1))
+          return false;
+        if (frame_type==event_frame) {
+          size_t size;
+          if (not read_stats(worker.result_fd, worker.stats_so_far)
+              or not read_all(worker.result_fd, &size, sizeof(size)))
+            return false;
+          string encoded(size, '\0');
+          if (not read_all(worker.result_fd, encoded.data(), size))
+            return false;
+          size_t pos=0;
+          auto event=decode(encoded, pos);
+          track_open_events(worker.open_events, event);
+          replay(event, *result.format);
+        }
+        else if (frame_type==done_frame) {
+          TestStats stats;
+          if (not read_stats(worker.result_fd, stats))
+            return false;
+          result.stats+=stats;
+          record_duration(worker);
+          dispatch(worker);
+        }
+        else
+          throw runtime_error("unknown frame from test process");
+        return true;
+      };
+
+    // the stats of a crashed test function are those sent along with its
+    // last event, plus an error; "why", if not empty, replaces the worker's
+    // exit status as the reason
+    auto report_death=
+      [&](worker_t &worker, string why) {
+        int status=0;
+        close_worker(worker);
+        waitpid(worker.pid, &status, 0);
+        if (why.empty())
+          why=describe_worker_death(status);
+        auto const &result=results[worker.task];
+        // close whatever the test function left open, as stack unwinding
+        // would have done for an exception
+        for (auto e=worker.open_events.rbegin();
+             e not_eq worker.open_events.rend(); ++e)
+          replay(closing_event(*e), *result.format);
+        result.format->uncaught_exception(why);
+        auto timing=result.format->get_timing();
+        timing.end=monotonic_time();
+        result.format->set_timing(timing);
+        result.stats+=worker.stats_so_far;
+        result.stats.unexpected_error();
+        record_duration(worker);
+        worker.pid=-1;
+        worker.task=no_task;
+      };
+
+    while (true) {
+      vector<pollfd> poll_fds;
+      vector<size_t> busy_workers;
+      for (size_t i=0; i<workers.size(); ++i)
+        if (workers[i].task not_eq no_task) {
+          poll_fds.push_back({workers[i].result_fd, POLLIN, 0});
+          busy_workers.push_back(i);
+        }
+      if (poll_fds.empty())
+        break;
+      // wait no longer than until the first busy worker times out
+      int poll_timeout=-1;
+      if (timeout>0.) {
+        auto now=chrono::steady_clock::now();
+        double first_deadline=timeout;
+        for (auto i: busy_workers)
+          first_deadline=
+            min(first_deadline,
+                timeout-chrono::duration<double>(now-workers[i].start)
+                        .count());
+        poll_timeout=static_cast<int>(max(0., ceil(first_deadline*1e3)));
+      }
+      if (poll(poll_fds.data(), poll_fds.size(), poll_timeout)<0) {
+        if (errno==EINTR)
+          continue;
+        throw runtime_error(string("poll() error: ")+strerror(errno));
+      }
+      // replace a dead worker, if there's still work to do
+      auto replace=
+        [&](worker_t &worker) {
+          if (next_task<tests.size()) {
+            worker=spawn_worker(tests);
+            dispatch(worker);
+          }
+        };
+      for (size_t j=0; j<poll_fds.size(); ++j) {
+        auto &worker=workers[busy_workers[j]];
+        if (poll_fds[j].revents) {
+          if (not receive(worker)) {
+            report_death(worker, "");
+            replace(worker);
+          }
+        }
+        else if ((timeout>0.)
+                 and (chrono::duration<double>(
+                        chrono::steady_clock::now()-worker.start).count()
+                      >=timeout)) {
+          kill(worker.pid, SIGKILL);
+          ostringstream why;
+          why << "test process killed after the timeout of " << timeout
+              << " s";
+          report_death(worker, why.str());
+          replace(worker);
+        }
+      }
+    }
+
+    // idle workers exit when their command pipe is closed
+    for (auto &worker: workers)
+      if (worker.pid>=0)
+        close_worker(worker);
+    for (auto &worker: workers)
+      if (worker.pid>=0)
+        waitpid(worker.pid, nullptr, 0);
+  }
+
+}
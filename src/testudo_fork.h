@@ -0,0 +1,48 @@
+// Copyright © 2020-2023 Miguel González Cuadrado <mgcuadrado@gmail.com>
+
+// This file is part of Testudo.
+
+//     Testudo is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+
+//     Testudo is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+
+//     You should have received a copy of the GNU General Public License
+//     along with Testudo.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MGCUADRADO_TESTUDO_FORK_HEADER_
+#define MGCUADRADO_TESTUDO_FORK_HEADER_
+
+#include "testudo_format.h"
+#include <vector>
+#include <functional>
+
+namespace testudo___implementation {
+
+  using isolated_test_f_t=std::function<void (test_management_t)>;
+
+  // run each test function "tests[i]" in a worker process, and feed its
+  // output and stats into "results[i]" in this process; a pool of
+  // "processes" workers is forked at the beginning, so that whatever the
+  // process has already loaded (e.g., the test libraries) is loaded only
+  // once, and the test functions are dispatched to them through pipes, as
+  // workers become idle; a worker crashing (e.g., a segmentation fault) or
+  // exiting while running a test function is reported as an uncaught
+  // exception and counted as an error for that test function, whose output
+  // up to the crash is kept, and the worker is replaced by a new one; if
+  // "timeout" is positive, a worker running a test function for that many
+  // seconds is killed, and reported likewise; the wall time of each test
+  // function, as seen from this process, is stored in "durations[i]"
+  void run_in_processes(std::vector<isolated_test_f_t> const &tests,
+                        std::vector<test_management_t> const &results,
+                        unsigned processes, double timeout,
+                        std::vector<double> &durations);
+
+}
+
+#endif
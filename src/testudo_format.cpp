@@ -17,11 +17,37 @@
 
 #include "testudo_format.h"
 #include <sstream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <climits>
 
 namespace testudo___implementation {
 
   using namespace std;
 
+  namespace {
+
+    auto const monotonic_origin=chrono::steady_clock::now();
+
+  }
+
+  double monotonic_time() {
+    return
+      chrono::duration<double>(chrono::steady_clock::now()-monotonic_origin)
+      .count();
+  }
+
+  unsigned JobBudget::take(unsigned wanted) {
+    auto available=spare.load();
+    unsigned taken;
+    do
+      taken=min(available, wanted);
+    while (not spare.compare_exchange_weak(available, available-taken));
+    return taken;
+  }
+
   class NullTestFormatForFixtures
     : public TestFormat {
   public:
@@ -43,6 +69,8 @@ namespace testudo___implementation {
     void output_try(string, bool) override { }
     void output_catch(string, string, string, bool) override { }
     void output_show_value(string, string) override { }
+    void output_benchmark(string, string, string, string, string,
+                          string, string, string, string) override { }
     void output_begin_with(string, string, string, string) override { }
     void output_end_with() override { }
     void output_begin_with_results() override { }
@@ -74,8 +102,11 @@ namespace testudo___implementation {
   public:
     WithLoopLog(test_format_p test_format, TestStats const &test_stats)
       : test_format(test_format), test_stats(test_stats),
-        init_test_stats(test_stats) { }
-    void reset_counter() { counter=0; }
+        init_test_stats(test_stats), start(monotonic_time()) { }
+    void start_iteration() {
+      counter=0;
+      iteration_failed=false;
+    }
     void incr_counter() {
       ++counter;
       if (counter>children.size()) {
@@ -94,15 +125,49 @@ namespace testudo___implementation {
         test_format->output_end_with_results();
       }
     }
-    void failed() { all_successful_p=false; }
+    void failed() {
+      all_successful_p=false;
+      if (not iteration_failed) {
+        iteration_failed=true;
+        ++n_failed_iterations_p;
+      }
+    }
     bool all_successful() const { return all_successful_p; }
+    size_t n_failed_iterations() const { return n_failed_iterations_p; }
+    void set_coverage(string coverage) { coverage_p=coverage; }
+    // what to add to the name of the loop in its summary
+    string coverage_suffix() const
+      { return coverage_p.empty() ? "" : " ("+coverage_p+")"; }
+    // take over the actions and children of "other", the log of later
+    // iterations of the same "with()"-loop, as if they had been logged here
+    void merge(WithLoopLog const &other) {
+      for (auto const &[location, other_actions]: other.actions) {
+        auto &location_actions=actions[location];
+        location_actions.insert(location_actions.end(),
+                                other_actions.begin(), other_actions.end());
+      }
+      for (size_t i=0; i<other.children.size(); ++i) {
+        if (i==children.size())
+          children.push_back(make_shared<WithLoopLog>(test_format,
+                                                      test_stats));
+        children[i]->merge(*other.children[i]);
+      }
+      if (not other.all_successful_p)
+        all_successful_p=false;
+      n_failed_iterations_p+=other.n_failed_iterations_p;
+    }
     TestStats test_stats_diff() const { return test_stats-init_test_stats; }
+    TestFormat::timing_t timing() const { return {start, monotonic_time()}; }
   private:
     test_format_p const test_format;
     TestStats const &test_stats;
     TestStats const init_test_stats;
+    double const start;
     size_t counter;
     bool all_successful_p=true;
+    bool iteration_failed=false;
+    size_t n_failed_iterations_p=0;
+    string coverage_p;
     vector<shared_ptr<WithLoopLog>> children;
     map<string, list<function<void ()>>> actions;
   };
@@ -138,7 +203,7 @@ namespace testudo___implementation {
     WithLoopTestFormat(test_format_p parent_test_format,
                        shared_ptr<WithLoopLog> log, bool last_time,
                        string var_name, string val,
-                       MultilineData container)
+                       MultilineData container, bool isolated=false)
       : parent_test_format(parent_test_format),
         non_with_ancestor(find_non_with_ancestor(parent_test_format)),
         log(log),
@@ -146,8 +211,9 @@ namespace testudo___implementation {
         recursively_last_time(
           last_time and parent_recursively_last_time(parent_test_format)),
         full_var_values(compute_full_var_values(var_name, val)),
-        loop_name(var_name+" in "+container.summary) {
-      log->reset_counter();
+        loop_name(var_name+" in "+container.summary),
+        isolated(isolated) {
+      log->start_iteration();
       output_begin_with(var_name,
                         container.first_line, container.rest_lines,
                         loop_name);
@@ -158,8 +224,14 @@ namespace testudo___implementation {
                     parent_test_format)) {
         // reset the location of the opening "with_data()"
         non_with_ancestor->set_location(with_location);
+        // the summary carries the loop's timing, but the ancestor's own
+        // timing (that of the enclosing test) must be kept for its report
+        auto ancestor_timing=non_with_ancestor->get_timing();
+        non_with_ancestor->set_timing(log->timing());
         non_with_ancestor
-          ->output_with_summary(loop_name, log->test_stats_diff());
+          ->output_with_summary(loop_name+log->coverage_suffix(),
+                                log->test_stats_diff());
+        non_with_ancestor->set_timing(ancestor_timing);
       }
       output_end_with();
     }
@@ -176,6 +248,10 @@ namespace testudo___implementation {
       { log->add(get_location(), output); }
     void failed() {
       log->failed();
+      // an isolated format runs on a thread of its own, and its failures
+      // reach the parent when its log is merged
+      if (isolated)
+        return;
       if (auto parent_with_loop=
             dynamic_pointer_cast<WithLoopTestFormat>(parent_test_format))
         parent_with_loop->failed();
@@ -263,6 +339,24 @@ namespace testudo___implementation {
         log->output(get_location());
       }
     }
+    void output_benchmark(string code_str,
+                          string ns_per_op, string ci_low, string ci_high,
+                          string allocations_per_op,
+                          string n_samples, string iterations,
+                          string n_outliers, string samples) override {
+      log->incr_counter();
+      log_output(
+        [=, nwa=non_with_ancestor]() {
+          nwa->output_benchmark(code_str, ns_per_op, ci_low, ci_high,
+                                allocations_per_op,
+                                n_samples, iterations, n_outliers, samples);
+        });
+      if (recursively_last_time) {
+        non_with_ancestor->output_benchmark(code_str,
+                                            "", "", "", "", "", "", "", "");
+        log->output(get_location());
+      }
+    }
     void output_begin_with(string var_name, string
                            container_first, string container_rest,
                            string summary) override {
@@ -361,6 +455,7 @@ namespace testudo___implementation {
     bool const recursively_last_time;
     var_values_t const full_var_values;
     string const loop_name;
+    bool const isolated;
   };
 
   shared_ptr<WithLoopLog> get_with_loop_log(test_management_t parent) {
@@ -433,4 +528,92 @@ namespace testudo___implementation {
     return {d, "", d.substr(0, i+1)+"..."+d.substr(d.rfind('}'))};
   }
 
+  size_t failed_iterations(WithLoopLog const &log)
+    { return log.n_failed_iterations(); }
+
+  void set_coverage(WithLoopLog &log, string coverage)
+    { log.set_coverage(coverage); }
+
+  void run_parallel_with_loop(
+    test_management_t test_management, size_t n,
+    string var_name, MultilineData container,
+    function<string (size_t, ostream &)> value_text,
+    function<void (size_t, test_management_t)> iteration,
+    string coverage) {
+    if (n==0)
+      return;
+    auto log=get_with_loop_log(test_management);
+    log->set_coverage(coverage);
+
+    // all the iterations but the last one, each one with a log, stats, and
+    // value format of its own
+    struct isolated_iteration_t {
+      shared_ptr<WithLoopLog> log;
+      TestStats stats;
+      exception_ptr exception;
+    };
+    vector<isolated_iteration_t> isolated_iterations(n-1);
+    atomic<size_t> next_i{0};
+    auto worker=
+      [&]() {
+        for (size_t i=next_i++; i<n-1; i=next_i++) {
+          auto &ii=isolated_iterations[i];
+          ii.log=make_shared<WithLoopLog>(test_management.format, ii.stats);
+          try {
+            auto test_vfos=make_shared<ValueFormatOStream>();
+            test_vfos->fmt_os.copyfmt(test_management.test_vfos->fmt_os);
+            iteration(
+              i,
+              {make_shared<WithLoopTestFormat>(
+                  test_management.format, ii.log, false,
+                  var_name, value_text(i, test_vfos->fmt_os), container,
+                  true),
+               test_vfos, ii.stats, test_management.test_name,
+               test_management.job_budget});
+          }
+          catch (...) {
+            ii.exception=current_exception();
+          }
+        }
+      };
+    // the calling thread is a worker too, so that's one less to start
+    auto wanted=static_cast<unsigned>(min<size_t>((n>2) ? n-2 : 0, UINT_MAX));
+    auto n_threads=
+      test_management.job_budget
+      ? test_management.job_budget->take(wanted)
+      : min(max(thread::hardware_concurrency(), 1u)-1, wanted);
+    vector<thread> threads;
+    for (unsigned j=0; j<n_threads; ++j)
+      threads.emplace_back(worker);
+    worker();
+    for (auto &t: threads)
+      t.join();
+    if (test_management.job_budget)
+      test_management.job_budget->give_back(n_threads);
+
+    // merge them in iteration order; the first exception ends the loop,
+    // just like it would have in a sequential run
+    auto parent_with_loop=
+      dynamic_pointer_cast<WithLoopTestFormat>(test_management.format);
+    for (auto const &ii: isolated_iterations) {
+      test_management.stats+=ii.stats;
+      if (ii.exception)
+        rethrow_exception(ii.exception);
+      log->merge(*ii.log);
+      if (parent_with_loop and not ii.log->all_successful())
+        parent_with_loop->failed();
+    }
+
+    // the last iteration outputs the contents of the loop, along with the
+    // merged logs
+    iteration(
+      n-1,
+      {make_with_loop_test_format(
+          test_management.format, log, true,
+          var_name, value_text(n-1, test_management.test_vfos->fmt_os),
+          container),
+       test_management.test_vfos, test_management.stats,
+       test_management.test_name, test_management.job_budget});
+  }
+
 }
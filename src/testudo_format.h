@@ -25,6 +25,9 @@
 #include <sstream>
 #include <string>
 #include <list>
+#include <functional>
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 
 namespace testudo___implementation {
@@ -68,6 +71,41 @@ namespace testudo___implementation {
       }
     };
     using var_values_t=std::list<std::pair<string, string>>;
+    // the span of time taken by a test (its test function and its children)
+    // or a "with()" loop, in seconds on a monotonic clock (see
+    // "monotonic_time()"); for test functions with a fixture, also the time
+    // taken by the fixture's constructor and destructor
+    struct timing_t {
+      double start=0., end=-1.; // "end<start" means no timing
+      double fixture_setup=0., fixture_teardown=0.;
+      bool empty() const { return end<start; }
+      double duration() const { return empty() ? 0. : end-start; }
+      // the smallest span including both spans
+      timing_t &operator|=(timing_t const &other) {
+        if (empty())
+          *this=other;
+        else if (not other.empty()) {
+          start=std::min(start, other.start);
+          end=std::max(end, other.end);
+        }
+        return *this;
+      }
+    };
+
+    // if true, human-readable formats show the duration of each test and
+    // "with()" loop, and list the "n_slowest_tests" slowest tests at the end
+    // of the report; it's false by default, so that reports are repeatable
+    inline static bool show_timing=false;
+    inline static unsigned n_slowest_tests=0;
+
+    // when formats that write as they go flush their output: after every
+    // element ("per_element"), when each test starts and ends ("per_test"),
+    // or whenever "flush_size" bytes are pending ("by_size"); flushing less
+    // often is cheaper, and, if the test process crashes, the "xml" format
+    // still writes what it has pending
+    enum class flush_policy_t { per_element, per_test, by_size };
+    inline static flush_policy_t flush_policy=flush_policy_t::per_test;
+    inline static std::size_t flush_size=std::size_t(1) << 16;
 
     virtual ~TestFormat() { };
 
@@ -82,6 +120,16 @@ namespace testudo___implementation {
     virtual string get_brief_location() const
       { return location_p.to_string_brief(title_location_p); }
 
+    // the timing applies to the next "produce_summary()" or
+    // "output_with_summary()"
+    virtual void set_timing(timing_t timing) { timing_p=timing; }
+    timing_t get_timing() const { return timing_p; }
+
+    // the own test function of the current test is about to be run; only
+    // formats that keep every event need it, to tell tests whose test
+    // function was run (e.g., in this shard) from the rest
+    virtual void start_test_function() { }
+
     virtual void output_title(string name, string title)=0;
     virtual void output_begin_indent()=0;
     virtual void output_end_indent()=0;
@@ -99,6 +147,16 @@ namespace testudo___implementation {
                               string caught, bool informative)=0;
     virtual void output_show_value(
       string expr_str, string value_str)=0;
+    // the result of timing "code_str": its time per run, in nanoseconds, with
+    // its confidence interval, the allocations per run, the number of
+    // samples, the runs per sample, the number of rejected samples, and the
+    // time per run of every sample, in nanoseconds, separated by spaces
+    virtual void output_benchmark(string code_str,
+                                  string ns_per_op,
+                                  string ci_low, string ci_high,
+                                  string allocations_per_op,
+                                  string n_samples, string iterations,
+                                  string n_outliers, string samples)=0;
     virtual void output_begin_with(string var_name,
                                    string container_first,
                                    string container_rest,
@@ -151,6 +209,7 @@ namespace testudo___implementation {
 
   protected:
     location_t title_location_p, location_p;
+    timing_t timing_p;
     std::pair<string, string> var_and_values_format(var_values_t);
   };
 
@@ -164,14 +223,36 @@ namespace testudo___implementation {
     }
   };
 
+  // seconds on a monotonic clock, since the Testudo library was loaded (and,
+  // therefore, the same in forked worker processes)
+  double monotonic_time();
+
   using test_format_p=std::shared_ptr<TestFormat>;
   using test_format_pc=std::shared_ptr<TestFormat const>;
   using value_format_ostream_t=std::shared_ptr<ValueFormatOStream>;
 
+  // the threads that parallel "with()" loops can add to those already
+  // running test functions, shared by all the test functions of a run, so
+  // that a run never uses more threads than its jobs; loops take what they
+  // can when they start, and give it back when they're done
+  class JobBudget {
+  public:
+    explicit JobBudget(unsigned spare) : spare(spare) { }
+    // take up to "wanted" threads (maybe none), and return how many
+    unsigned take(unsigned wanted);
+    void give_back(unsigned n) { spare+=n; }
+  private:
+    std::atomic<unsigned> spare;
+  };
+  using job_budget_p=std::shared_ptr<JobBudget>;
+
   struct test_management_t {
     test_format_p format;
     value_format_ostream_t test_vfos;
     TestStats &stats;
+    std::string test_name={}; // full name of the test being run, if any
+    // if null, parallel "with()" loops use every hardware thread
+    job_budget_p job_budget={};
   };
 
   define_named_creator(test_format_named_creator,
@@ -193,6 +274,13 @@ namespace testudo___implementation {
 
   class WithLoopLog;
   std::shared_ptr<WithLoopLog> get_with_loop_log(test_management_t parent);
+  // the number of iterations of a "with()"-loop that have failed so far (for
+  // a nested loop, over all the iterations of the enclosing loops)
+  std::size_t failed_iterations(WithLoopLog const &);
+  // a description of which data the loop goes through (e.g., the seed of a
+  // pseudorandom sample), added to the name of the loop in its summary, so
+  // that a failure can be reproduced
+  void set_coverage(WithLoopLog &, std::string coverage);
   // the following implementation is used for "with()"-loops; it calls
   // "output_begin_with()" and "output_end_with()", manages the first iteration
   // (the instructions must be reported on the first iteration only, so that we
@@ -207,6 +295,23 @@ namespace testudo___implementation {
                              std::string var_name, std::string val,
                              MultilineData container);
 
+  // run a parallel "with()"-loop over "n" values: all the iterations but the
+  // last one are run concurrently, each one on a "with()"-loop test format,
+  // log, and stats of its own; then, those logs are merged into the log of
+  // the loop in iteration order, and the last iteration is run on the
+  // calling thread, as in a sequential loop, so that the report is the same;
+  // an exception thrown by an iteration is rethrown once the previous ones
+  // have been merged, since that's where a sequential loop would have
+  // stopped; "value_text(i, fmt_os)" converts the "i"-th value to text,
+  // "iteration(i, test_management)" runs the body of the loop for it, and
+  // "coverage" goes to the summary, as with "set_coverage()"
+  void run_parallel_with_loop(
+    test_management_t test_management, std::size_t n,
+    std::string var_name, MultilineData container,
+    std::function<std::string (std::size_t, std::ostream &)> value_text,
+    std::function<void (std::size_t, test_management_t)> iteration,
+    std::string coverage={});
+
 }
 
 testudo___BRING(test_management_t,
@@ -0,0 +1,149 @@
+// Copyright © 2020-2023 Miguel González Cuadrado <mgcuadrado@gmail.com>
+
+// This file is part of Testudo.
+
+//     Testudo is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+
+//     Testudo is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+
+//     You should have received a copy of the GNU General Public License
+//     along with Testudo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "testudo_format_binary.h"
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdint>
+
+namespace testudo___implementation {
+
+  using namespace std;
+
+  namespace {
+
+    string const binary_magic="testudo-binary-5\n";
+
+    // the format is the magic string, followed by every event, encoded with
+    // a string table for the whole report, and prefixed by its encoded size;
+    // numbers are little-endian, of the width given (see "encode_le()"):
+    //
+    //     report: magic event*
+    //     event:  size:u64 kind:u8 informative:u8
+    //             n_passed:i64 n_failed:i64 n_errors:i64
+    //             start:f64 end:f64 fixture_setup:f64 fixture_teardown:f64
+    //             n_args:u32 string*
+    //     string: index:u32 [size:u64 byte*]
+    //
+    // the size of an event doesn't include its own field; strings are
+    // numbered from 0 in order of appearance, and only the first appearance
+    // of each one has its size and bytes; "kind" is the index in
+    // "test_format_event_t::kind_t", whose order must therefore be kept
+    // (new kinds go at the end), and "n_args" must be that of the kind;
+    // any change in the layout needs a new magic string
+    class TestFormatBinary
+      : public TestFormatRecord {
+    public:
+      TestFormatBinary(ostream &os) : ts(os) { ts << binary_magic << flush; }
+      ~TestFormatBinary() { write_buffer(); }
+    protected:
+      void record(test_format_event_t event) override {
+        encoded.clear();
+        encode(event, encoded, string_table);
+        encode_le(uint64_t(encoded.size()), buffer);
+        buffer+=encoded;
+        written(is_test_boundary(event.kind));
+      }
+    private:
+      ostream &ts;
+      encoding_string_table_t string_table;
+      string encoded; // reused, to avoid an allocation per event
+      // the events are written into "buffer", and moved from there to "ts"
+      // (and flushed) according to "flush_policy", as the XML format does
+      string buffer;
+      void written(bool test_boundary) {
+        switch (flush_policy) {
+        case flush_policy_t::per_element: write_buffer(); break;
+        case flush_policy_t::per_test:
+          if (test_boundary)
+            write_buffer();
+          break;
+        case flush_policy_t::by_size:
+          if (buffer.size()>=flush_size)
+            write_buffer();
+          break;
+        default:
+          throw runtime_error("unknown flush policy");
+        }
+      }
+      void write_buffer() {
+        ts.write(buffer.data(), streamsize(buffer.size()));
+        ts << flush;
+        buffer.clear();
+      }
+      static bool is_test_boundary(test_format_event_t::kind_t kind) {
+        return
+          (kind==test_format_event_t::output_title)
+          or (kind==test_format_event_t::produce_summary);
+      }
+      inline static pattern::register_creator<TestFormatBinary>
+        rc{test_format_named_creator(), "binary"};
+    };
+
+  }
+
+  test_format_events_t read_binary_events(istream &is) {
+    string magic(binary_magic.size(), '\0');
+    if (not is.read(magic.data(), streamsize(magic.size()))
+        or (magic not_eq binary_magic))
+      throw runtime_error("not a Testudo binary report");
+    test_format_events_t events;
+    decoding_string_table_t string_table;
+    string encoded;
+    char size_field[sizeof(uint64_t)];
+    while (is.read(size_field, sizeof(size_field))) {
+      auto size=decode_le<uint64_t>(size_field);
+      // the size comes from the file, so it can't be trusted to allocate
+      // the whole event up front; the event is read in chunks, so that a
+      // corrupt size runs out of input rather than out of memory
+      size_t const chunk_size=size_t(1) << 16;
+      encoded.clear();
+      while (encoded.size()<size) {
+        auto const old_size=encoded.size();
+        encoded.resize(old_size+min(chunk_size, size-old_size));
+        if (not is.read(encoded.data()+old_size,
+                        streamsize(encoded.size()-old_size)))
+          throw runtime_error("truncated Testudo binary report");
+      }
+      size_t pos=0;
+      events.push_back(decode(encoded, pos, string_table));
+      if (pos not_eq encoded.size())
+        throw runtime_error("corrupt Testudo binary report");
+    }
+    if (is.gcount() not_eq 0)
+      throw runtime_error("truncated Testudo binary report");
+    return events;
+  }
+
+  void testudo_binary_to(string const &format_name, opts_t opts) {
+    while (opts) {
+      if (auto d=opts.opt_arg("-d"))
+        TestFormat::location_t::common_directory=d;
+      else if (auto t=opts.opt_arg("-T")) {
+        TestFormat::show_timing=true;
+        TestFormat::n_slowest_tests=static_cast<unsigned>(stoul(t));
+      }
+      else
+        throw runtime_error("unknown option \""+opts.arg()+"\"");
+    }
+    auto test_format=test_format_named_creator(format_name)(cout);
+    replay(read_binary_events(cin), *test_format);
+    test_format->print_test_readout();
+  }
+
+}
@@ -0,0 +1,43 @@
+// Copyright © 2020-2023 Miguel González Cuadrado <mgcuadrado@gmail.com>
+
+// This file is part of Testudo.
+
+//     Testudo is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+
+//     Testudo is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+
+//     You should have received a copy of the GNU General Public License
+//     along with Testudo.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MGCUADRADO_TESTUDO_FORMAT_BINARY_HEADER_
+#define MGCUADRADO_TESTUDO_FORMAT_BINARY_HEADER_
+
+#include "testudo_format_record.h"
+#include "testudo_opt.h"
+#include <istream>
+#include <string>
+
+namespace testudo___implementation {
+
+  // the "binary" test format writes every test format event, as encoded by
+  // "encode()", so that the whole run can be read back and replayed on any
+  // other test format; this function reads back the events, and throws if
+  // the stream isn't in that format
+  test_format_events_t read_binary_events(std::istream &);
+
+  // render a binary report, read from the standard input, in another test
+  // format, as if the tests had been run with that format; this is what the
+  // "binary_to_xml", "binary_to_color" and "binary_to_track" commands do:
+  //
+  //     testudo binary_to_color [-d <common_directory>] [-T <n>] <report
+  void testudo_binary_to(std::string const &format_name, opts_t);
+
+}
+
+#endif
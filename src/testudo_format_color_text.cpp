@@ -114,6 +114,22 @@ namespace {
       typeset->show_value(expr_str, value_str);
     }
 
+    void output_benchmark(string code_str,
+                          string ns_per_op, string ci_low, string ci_high,
+                          string allocations_per_op,
+                          string n_samples, string iterations,
+                          string n_outliers, string) override {
+      output_location();
+      // the measurements change from run to run, so they're shown only
+      // along with the timing
+      if (show_timing)
+        typeset->benchmark(code_str, ns_per_op, ci_low, ci_high,
+                           allocations_per_op,
+                           n_samples, iterations, n_outliers);
+      else
+        typeset->benchmark(code_str, "", "", "", "", "", "", "");
+    }
+
     void output_begin_with(string var_name,
                            string container_first, string container_rest,
                            string) override {
@@ -129,6 +145,8 @@ namespace {
 
     template <typename M>
     void output_summary(M summary, string name, TestStats test_stats) {
+      if (show_timing and not get_timing().empty())
+        typeset->timing(get_timing().duration());
       auto
         n_failed=test_stats.n_failed(),
         n_total=n_failed+test_stats.n_passed(),
@@ -190,7 +208,11 @@ namespace {
       typeset->uncaught_exception(exception);
     }
 
-    void print_test_readout() const override { } // already wrote everything
+    // everything else is already written
+    void print_test_readout() const override {
+      if (show_timing)
+        typeset->slowest_tests(n_slowest_tests);
+    }
 
   private:
     inline static pattern::register_creator<TestFormatColorText>
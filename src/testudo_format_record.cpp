@@ -0,0 +1,373 @@
+// Copyright © 2020-2023 Miguel González Cuadrado <mgcuadrado@gmail.com>
+
+// This file is part of Testudo.
+
+//     Testudo is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+
+//     Testudo is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+
+//     You should have received a copy of the GNU General Public License
+//     along with Testudo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "testudo_format_record.h"
+#include <stdexcept>
+
+namespace testudo___implementation {
+
+  using namespace std;
+
+  using ev=test_format_event_t;
+
+  void TestFormatRecord::record(test_format_event_t event)
+    { events_p.push_back(move(event)); }
+
+  void TestFormatRecord::set_location(location_t location) {
+    TestFormat::set_location(location);
+    record({ev::set_location, {location.file, location.line}});
+  }
+  void TestFormatRecord::set_title_location(location_t location) {
+    TestFormat::set_title_location(location);
+    record({ev::set_title_location, {location.file, location.line}});
+  }
+
+  void TestFormatRecord::set_timing(timing_t timing) {
+    TestFormat::set_timing(timing);
+    record({ev::set_timing, {}, false, {}, timing});
+  }
+
+  void TestFormatRecord::start_test_function()
+    { record({ev::start_test_function, {}}); }
+
+  void TestFormatRecord::output_title(string name, string title)
+    { record({ev::output_title, {name, title}}); }
+  void TestFormatRecord::output_begin_indent()
+    { record({ev::output_begin_indent, {}}); }
+  void TestFormatRecord::output_end_indent()
+    { record({ev::output_end_indent, {}}); }
+  void TestFormatRecord::output_begin_scope(string name)
+    { record({ev::output_begin_scope, {name}}); }
+  void TestFormatRecord::output_end_scope(string name)
+    { record({ev::output_end_scope, {name}}); }
+  void TestFormatRecord::output_begin_declare_scope(string code_str)
+    { record({ev::output_begin_declare_scope, {code_str}}); }
+  void TestFormatRecord::output_end_declare_scope()
+    { record({ev::output_end_declare_scope, {}}); }
+  void TestFormatRecord::output_separator()
+    { record({ev::output_separator, {}}); }
+  void TestFormatRecord::output_step_id(string id)
+    { record({ev::output_step_id, {id}}); }
+  void TestFormatRecord::output_text(string text)
+    { record({ev::output_text, {text}}); }
+  void TestFormatRecord::output_declare(string code_str)
+    { record({ev::output_declare, {code_str}}); }
+  void TestFormatRecord::output_perform(string code_str)
+    { record({ev::output_perform, {code_str}}); }
+  void TestFormatRecord::output_try(string code_str, bool informative)
+    { record({ev::output_try, {code_str}, informative}); }
+  void TestFormatRecord::output_catch(string exception_type, string error,
+                                      string caught, bool informative) {
+    record({ev::output_catch, {exception_type, error, caught}, informative});
+  }
+  void TestFormatRecord::output_show_value(string expr_str, string value_str)
+    { record({ev::output_show_value, {expr_str, value_str}}); }
+  void TestFormatRecord::output_benchmark(string code_str,
+                                          string ns_per_op,
+                                          string ci_low, string ci_high,
+                                          string allocations_per_op,
+                                          string n_samples,
+                                          string iterations,
+                                          string n_outliers,
+                                          string samples) {
+    record({ev::output_benchmark,
+            {code_str, ns_per_op, ci_low, ci_high, allocations_per_op,
+             n_samples, iterations, n_outliers, samples}});
+  }
+  void TestFormatRecord::output_begin_with(string var_name,
+                                           string container_first,
+                                           string container_rest,
+                                           string summary) {
+    record({ev::output_begin_with,
+            {var_name, container_first, container_rest, summary}});
+  }
+  void TestFormatRecord::output_end_with()
+    { record({ev::output_end_with, {}}); }
+  void TestFormatRecord::output_begin_with_results()
+    { record({ev::output_begin_with_results, {}}); }
+  void TestFormatRecord::output_end_with_results()
+    { record({ev::output_end_with_results, {}}); }
+  void TestFormatRecord::output_with_summary(string name,
+                                             TestStats test_stats)
+    { record({ev::output_with_summary, {name}, false, test_stats}); }
+  void TestFormatRecord::output_check_true(string expr_str,
+                                           string exprv_str, string valv_str,
+                                           string explanation,
+                                           string success,
+                                           string prefix,
+                                           bool informative) {
+    record({ev::output_check_true,
+            {expr_str, exprv_str, valv_str, explanation, success, prefix},
+            informative});
+  }
+  void TestFormatRecord::output_check_equal(string expr1_str, string val1_str,
+                                            string expr2_str, string val2_str,
+                                            string exprv_str, string valv_str,
+                                            string explanation,
+                                            string success,
+                                            string prefix,
+                                            bool informative) {
+    record({ev::output_check_equal,
+            {expr1_str, val1_str, expr2_str, val2_str,
+             exprv_str, valv_str, explanation, success, prefix},
+            informative});
+  }
+  void TestFormatRecord::output_check_approx(string expr1_str,
+                                             string val1_str,
+                                             string expr2_str,
+                                             string val2_str,
+                                             string max_error_str,
+                                             string exprv_str,
+                                             string valv_str,
+                                             string explanation,
+                                             string success,
+                                             string prefix,
+                                             bool informative) {
+    record({ev::output_check_approx,
+            {expr1_str, val1_str, expr2_str, val2_str, max_error_str,
+             exprv_str, valv_str, explanation, success, prefix},
+            informative});
+  }
+  void TestFormatRecord::uncaught_exception(string exception)
+    { record({ev::uncaught_exception, {exception}}); }
+  void TestFormatRecord::produce_summary(string name, TestStats test_stats)
+    { record({ev::produce_summary, {name}, false, test_stats}); }
+
+  namespace {
+
+    // the number of string arguments of each event kind, to check decoded
+    // and replayed events before indexing their arguments
+    size_t const n_args_of_kind[ev::n_kinds]={
+      2, 2, // set_location, set_title_location
+      2, // output_title
+      0, 0, // output_begin_indent, output_end_indent
+      1, 1, // output_begin_scope, output_end_scope
+      1, 0, // output_begin_declare_scope, output_end_declare_scope
+      0, 1, 1, // output_separator, output_step_id, output_text
+      1, 1, // output_declare, output_perform
+      1, 3, // output_try, output_catch
+      2, // output_show_value
+      4, 0, // output_begin_with, output_end_with
+      0, 0, // output_begin_with_results, output_end_with_results
+      1, // output_with_summary
+      6, 9, 10, // output_check_true, output_check_equal, output_check_approx
+      1, // uncaught_exception
+      1, // produce_summary
+      0, // set_timing
+      9, // output_benchmark
+      0 // start_test_function
+    };
+
+    void check_n_args(ev::kind_t kind, size_t n_args) {
+      if (kind>=ev::n_kinds)
+        throw runtime_error("unknown test format event kind");
+      if (n_args not_eq n_args_of_kind[kind])
+        throw runtime_error("wrong number of arguments in test format event");
+    }
+
+  }
+
+  void replay(test_format_events_t const &events, TestFormat &tf) {
+    for (auto const &e: events)
+      replay(e, tf);
+  }
+
+  void replay(test_format_event_t const &e, TestFormat &tf) {
+    check_n_args(e.kind, e.args.size());
+    auto const &a=e.args;
+    switch (e.kind) {
+    case ev::set_location: tf.set_location({a[0], a[1]}); break;
+    case ev::set_title_location:
+      tf.set_title_location({a[0], a[1]}); break;
+    case ev::output_title: tf.output_title(a[0], a[1]); break;
+    case ev::output_begin_indent: tf.output_begin_indent(); break;
+    case ev::output_end_indent: tf.output_end_indent(); break;
+    case ev::output_begin_scope: tf.output_begin_scope(a[0]); break;
+    case ev::output_end_scope: tf.output_end_scope(a[0]); break;
+    case ev::output_begin_declare_scope:
+      tf.output_begin_declare_scope(a[0]); break;
+    case ev::output_end_declare_scope: tf.output_end_declare_scope(); break;
+    case ev::output_separator: tf.output_separator(); break;
+    case ev::output_step_id: tf.output_step_id(a[0]); break;
+    case ev::output_text: tf.output_text(a[0]); break;
+    case ev::output_declare: tf.output_declare(a[0]); break;
+    case ev::output_perform: tf.output_perform(a[0]); break;
+    case ev::output_try: tf.output_try(a[0], e.informative); break;
+    case ev::output_catch:
+      tf.output_catch(a[0], a[1], a[2], e.informative); break;
+    case ev::output_show_value: tf.output_show_value(a[0], a[1]); break;
+    case ev::output_begin_with:
+      tf.output_begin_with(a[0], a[1], a[2], a[3]); break;
+    case ev::output_end_with: tf.output_end_with(); break;
+    case ev::output_begin_with_results:
+      tf.output_begin_with_results(); break;
+    case ev::output_end_with_results: tf.output_end_with_results(); break;
+    case ev::output_with_summary:
+      tf.output_with_summary(a[0], e.test_stats); break;
+    case ev::output_check_true:
+      tf.output_check_true(a[0], a[1], a[2], a[3], a[4], a[5],
+                           e.informative);
+      break;
+    case ev::output_check_equal:
+      tf.output_check_equal(a[0], a[1], a[2], a[3], a[4], a[5], a[6],
+                            a[7], a[8], e.informative);
+      break;
+    case ev::output_check_approx:
+      tf.output_check_approx(a[0], a[1], a[2], a[3], a[4], a[5], a[6],
+                             a[7], a[8], a[9], e.informative);
+      break;
+    case ev::uncaught_exception: tf.uncaught_exception(a[0]); break;
+    case ev::produce_summary: tf.produce_summary(a[0], e.test_stats); break;
+    case ev::set_timing: tf.set_timing(e.timing); break;
+    case ev::output_benchmark:
+      tf.output_benchmark(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7],
+                          a[8]);
+      break;
+    case ev::start_test_function: tf.start_test_function(); break;
+    case ev::n_kinds:
+    default:
+      throw runtime_error("unknown test format event kind");
+    }
+  }
+
+  namespace {
+
+    template <typename T>
+    void encode_raw(T const &value, string &buffer)
+      { encode_le(value, buffer); }
+
+    template <typename T>
+    T decode_raw(string const &buffer, size_t &pos) {
+      if (buffer.size()-pos<sizeof(T))
+        throw runtime_error("truncated test format event");
+      auto value=decode_le<T>(buffer.data()+pos);
+      pos+=sizeof(T);
+      return value;
+    }
+
+  }
+
+  namespace {
+
+    // the fields of an event, with its string arguments encoded and decoded
+    // by "encode_arg()" and "decode_arg()"
+
+    template <typename E>
+    void encode_fields(test_format_event_t const &event, string &buffer,
+                       E &&encode_arg) {
+      encode_raw(uint8_t(event.kind), buffer);
+      encode_raw(uint8_t(event.informative), buffer);
+      encode_raw(int64_t(event.test_stats.n_passed()), buffer);
+      encode_raw(int64_t(event.test_stats.n_failed()), buffer);
+      encode_raw(int64_t(event.test_stats.n_errors()), buffer);
+      encode_raw(event.timing.start, buffer);
+      encode_raw(event.timing.end, buffer);
+      encode_raw(event.timing.fixture_setup, buffer);
+      encode_raw(event.timing.fixture_teardown, buffer);
+      encode_raw(uint32_t(event.args.size()), buffer);
+      for (auto const &arg: event.args)
+        encode_arg(arg);
+    }
+
+    template <typename D>
+    test_format_event_t decode_fields(string const &buffer, size_t &pos,
+                                      D &&decode_arg) {
+      test_format_event_t event;
+      event.kind=ev::kind_t(decode_raw<uint8_t>(buffer, pos));
+      auto informative=decode_raw<uint8_t>(buffer, pos);
+      if (informative>1)
+        throw runtime_error("invalid flag in test format event");
+      event.informative=(informative==1);
+      auto n_passed=integer(decode_raw<int64_t>(buffer, pos));
+      auto n_failed=integer(decode_raw<int64_t>(buffer, pos));
+      auto n_errors=integer(decode_raw<int64_t>(buffer, pos));
+      event.test_stats=TestStats(n_passed, n_failed, n_errors);
+      event.timing.start=decode_raw<double>(buffer, pos);
+      event.timing.end=decode_raw<double>(buffer, pos);
+      event.timing.fixture_setup=decode_raw<double>(buffer, pos);
+      event.timing.fixture_teardown=decode_raw<double>(buffer, pos);
+      auto n_args=size_t(decode_raw<uint32_t>(buffer, pos));
+      check_n_args(event.kind, n_args);
+      event.args.resize(n_args);
+      for (auto &arg: event.args)
+        arg=decode_arg();
+      return event;
+    }
+
+    void encode_string(string const &s, string &buffer) {
+      encode_raw(uint64_t(s.size()), buffer);
+      buffer+=s;
+    }
+
+    string decode_string(string const &buffer, size_t &pos) {
+      auto size=decode_raw<uint64_t>(buffer, pos);
+      if (buffer.size()-pos<size)
+        throw runtime_error("truncated test format event");
+      auto s=buffer.substr(pos, size);
+      pos+=size;
+      return s;
+    }
+
+  }
+
+  void encode(test_format_event_t const &event, string &buffer) {
+    encode_fields(event, buffer,
+                  [&buffer](string const &arg) { encode_string(arg, buffer); });
+  }
+
+  test_format_event_t decode(string const &buffer, size_t &pos) {
+    return
+      decode_fields(buffer, pos,
+                    [&buffer, &pos] { return decode_string(buffer, pos); });
+  }
+
+  // a string is encoded as its index in the table; a new string gets the
+  // next index, and is followed by its size and contents
+
+  void encoding_string_table_t::encode(string const &s, string &buffer) {
+    auto [i, is_new]=indices.try_emplace(s, uint32_t(indices.size()));
+    encode_raw(i->second, buffer);
+    if (is_new)
+      encode_string(s, buffer);
+  }
+
+  string const &decoding_string_table_t::decode(string const &buffer,
+                                                size_t &pos) {
+    auto index=decode_raw<uint32_t>(buffer, pos);
+    if (index==strings.size())
+      strings.push_back(decode_string(buffer, pos));
+    else if (index>strings.size())
+      throw runtime_error("unknown string in test format event");
+    return strings[index];
+  }
+
+  void encode(test_format_event_t const &event, string &buffer,
+              encoding_string_table_t &table) {
+    encode_fields(event, buffer,
+                  [&buffer, &table](string const &arg)
+                    { table.encode(arg, buffer); });
+  }
+
+  test_format_event_t decode(string const &buffer, size_t &pos,
+                             decoding_string_table_t &table) {
+    return
+      decode_fields(buffer, pos,
+                    [&buffer, &pos, &table]
+                      { return table.decode(buffer, pos); });
+  }
+
+}
@@ -0,0 +1,227 @@
+// Copyright © 2020-2023 Miguel González Cuadrado <mgcuadrado@gmail.com>
+
+// This file is part of Testudo.
+
+//     Testudo is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+
+//     Testudo is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+
+//     You should have received a copy of the GNU General Public License
+//     along with Testudo.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MGCUADRADO_TESTUDO_FORMAT_RECORD_HEADER_
+#define MGCUADRADO_TESTUDO_FORMAT_RECORD_HEADER_
+
+#include "testudo_format.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace testudo___implementation {
+
+  // a test format event is the record of a single call to a "TestFormat"
+  // method (location and timing setters included); it keeps the string
+  // arguments in call order, and, for the methods that have them, the
+  // "informative" flag and the "TestStats" and "timing_t" arguments
+  struct test_format_event_t {
+    enum kind_t : unsigned char {
+      set_location, set_title_location,
+      output_title,
+      output_begin_indent, output_end_indent,
+      output_begin_scope, output_end_scope,
+      output_begin_declare_scope, output_end_declare_scope,
+      output_separator, output_step_id, output_text,
+      output_declare, output_perform,
+      output_try, output_catch,
+      output_show_value,
+      output_begin_with, output_end_with,
+      output_begin_with_results, output_end_with_results,
+      output_with_summary,
+      output_check_true, output_check_equal, output_check_approx,
+      uncaught_exception,
+      produce_summary,
+      set_timing,
+      output_benchmark,
+      start_test_function,
+      n_kinds // not an event; just the number of event kinds
+    };
+    kind_t kind;
+    std::vector<std::string> args;
+    bool informative=false;
+    TestStats test_stats={};
+    TestFormat::timing_t timing={};
+  };
+  using test_format_events_t=std::vector<test_format_event_t>;
+
+  // replay an event, or a sequence of events, on a test format, calling its
+  // methods in the same order and with the same arguments as they were
+  // recorded
+  void replay(test_format_event_t const &, TestFormat &);
+  void replay(test_format_events_t const &, TestFormat &);
+
+  // binary encoding of events, to send them to another process, or to save
+  // them (see "testudo_format_binary.cpp" for the layout); "encode()"
+  // appends the encoded event to "buffer"; "decode()" decodes an
+  // event from "buffer" starting at "pos", which is advanced past it, and
+  // throws if "buffer" doesn't contain a whole event there
+  void encode(test_format_event_t const &, std::string &buffer);
+  test_format_event_t decode(std::string const &buffer, std::size_t &pos);
+
+  // the numbers in binary encodings are portable, so that they can be read
+  // on a machine other than the one that wrote them: integers are encoded
+  // little-endian, with the width of their type ("T" must be fixed-width);
+  // signed integers, as their two's complement; and doubles, as their
+  // IEEE 754 binary64 bits, little-endian; "decode_le()" reads
+  // "sizeof(T)" bytes at "data", which the caller must have checked
+  template <typename T>
+  void encode_le(T value, std::string &buffer) {
+    if constexpr (std::is_floating_point_v<T>) {
+      static_assert(std::numeric_limits<T>::is_iec559 and (sizeof(T)==8));
+      std::uint64_t bits;
+      std::memcpy(&bits, &value, sizeof(bits));
+      encode_le(bits, buffer);
+    }
+    else {
+      auto u=static_cast<std::make_unsigned_t<T>>(value);
+      for (std::size_t i=0; i<sizeof(T); ++i)
+        buffer+=static_cast<char>(static_cast<unsigned char>(u >> (8*i)));
+    }
+  }
+  template <typename T>
+  T decode_le(char const *data) {
+    if constexpr (std::is_floating_point_v<T>) {
+      static_assert(std::numeric_limits<T>::is_iec559 and (sizeof(T)==8));
+      auto bits=decode_le<std::uint64_t>(data);
+      T value;
+      std::memcpy(&value, &bits, sizeof(value));
+      return value;
+    }
+    else {
+      using U=std::make_unsigned_t<T>;
+      U u=0;
+      for (std::size_t i=0; i<sizeof(T); ++i)
+        u=static_cast<U>(
+            u | static_cast<U>(
+                  static_cast<U>(static_cast<unsigned char>(data[i]))
+                  << (8*i)));
+      return static_cast<T>(u);
+    }
+  }
+
+  // string tables deduplicate the string arguments of a sequence of encoded
+  // events (test names, code, values, and so on, are often repeated): each
+  // different string is encoded only the first time it appears, and later
+  // on, just its index in the table; the events must be decoded in the same
+  // order as they were encoded, each with the same string table throughout
+  class encoding_string_table_t {
+  public:
+    // append a reference to "s", and "s" itself if it's new
+    void encode(std::string const &s, std::string &buffer);
+  private:
+    std::unordered_map<std::string, std::uint32_t> indices;
+  };
+  class decoding_string_table_t {
+  public:
+    std::string const &decode(std::string const &buffer, std::size_t &pos);
+  private:
+    std::vector<std::string> strings;
+  };
+  void encode(test_format_event_t const &, std::string &buffer,
+              encoding_string_table_t &);
+  test_format_event_t decode(std::string const &buffer, std::size_t &pos,
+                             decoding_string_table_t &);
+
+  // the following test format doesn't write anything; instead, it records
+  // every call as an event, so that the calls can be replayed later on
+  // another test format; this is what allows running tests concurrently, each
+  // one on its own record, and then dumping them in the same order as a
+  // sequential run would have produced; it mustn't be registered for
+  // creation by name, since it has nowhere to write to
+  class TestFormatRecord
+    : public TestFormat {
+  public:
+    void set_location(location_t location) override;
+    void set_title_location(location_t location) override;
+    void set_timing(timing_t timing) override;
+    void start_test_function() override;
+
+    void output_title(string name, string title) override;
+    void output_begin_indent() override;
+    void output_end_indent() override;
+    void output_begin_scope(string name) override;
+    void output_end_scope(string name) override;
+    void output_begin_declare_scope(string code_str) override;
+    void output_end_declare_scope() override;
+    void output_separator() override;
+    void output_step_id(string id) override;
+    void output_text(string text) override;
+    void output_declare(string code_str) override;
+    void output_perform(string code_str) override;
+    void output_try(string code_str, bool informative) override;
+    void output_catch(string exception_type, string error,
+                      string caught, bool informative) override;
+    void output_show_value(string expr_str, string value_str) override;
+    void output_benchmark(string code_str,
+                          string ns_per_op, string ci_low, string ci_high,
+                          string allocations_per_op,
+                          string n_samples, string iterations,
+                          string n_outliers, string samples) override;
+    void output_begin_with(string var_name,
+                           string container_first, string container_rest,
+                           string summary) override;
+    void output_end_with() override;
+    void output_begin_with_results() override;
+    void output_end_with_results() override;
+    void output_with_summary(string name, TestStats test_stats) override;
+    void output_check_true(string expr_str,
+                           string exprv_str, string valv_str,
+                           string explanation,
+                           string success,
+                           string prefix,
+                           bool informative) override;
+    void output_check_equal(string expr1_str, string val1_str,
+                            string expr2_str, string val2_str,
+                            string exprv_str, string valv_str,
+                            string explanation,
+                            string success,
+                            string prefix,
+                            bool informative) override;
+    void output_check_approx(string expr1_str, string val1_str,
+                             string expr2_str, string val2_str,
+                             string max_error_str,
+                             string exprv_str, string valv_str,
+                             string explanation,
+                             string success,
+                             string prefix,
+                             bool informative) override;
+    void uncaught_exception(string exception) override;
+    void produce_summary(string name, TestStats test_stats) override;
+
+    void print_test_readout() const override { } // nothing to print
+
+    test_format_events_t const &events() const { return events_p; }
+    void replay(TestFormat &test_format) const
+      { testudo___implementation::replay(events_p, test_format); }
+
+  protected:
+    // every event goes through here; derived classes can override it to do
+    // something more with each event as it's recorded
+    virtual void record(test_format_event_t event);
+
+  private:
+    test_format_events_t events_p;
+  };
+
+}
+
+#endif
@@ -18,6 +18,7 @@
 #include "testudo_format.h"
 #include "crc.h"
 #include <iostream>
+#include <algorithm>
 
 namespace {
 
@@ -40,6 +41,8 @@ namespace {
   //     * 'v-' value display
   //
   //     * 'e-' error
+  //
+  //     * 'b-' benchmark, with the time per run of every sample
 
   class TestFormatTrack
     : public TestFormat {
@@ -54,10 +57,13 @@ namespace {
         +"-"+to_string(test_stats.n_errors());
     }
 
-    string crc(string code)
-      { return "["+to_hex(crc64(code))+"]"; }
-    string crc(string code, string content)
-      { return crc(code+" "+content); }
+    static string crc(crc64_t c)
+      { return "["+to_hex(c)+"]"; }
+    string crc(string const &code)
+      { return crc(crc64(code)); }
+    // the same as "crc(code+" "+content)", without building that string
+    string crc(string const &code, string const &content)
+      { return crc(crc64(content, crc64(" ", crc64(code)))); }
     void encode(char category, string code)
       { ts << category << "-" << code << "\n"; }
     void encode(char category, string code, string content)
@@ -92,6 +98,13 @@ namespace {
          << "c-" << code << " " << crc(code, content) << " "
          << encode_stats(test_stats) << "\n";
     }
+    // the sample times are separated by commas, so that they're a single
+    // word, and prefixed with "s-"
+    void encode_benchmark(string code_str, string samples) {
+      replace(samples.begin(), samples.end(), ' ', ',');
+      ts << encode_location()
+         << "b-benchmark " << crc(code_str) << " s-" << samples << "\n";
+    }
     void encode_uncaught(string exception) {
       ts << encode_location()
          << "e-uncaught_exception " << crc(exception) << " "
@@ -130,6 +143,13 @@ namespace {
     void output_show_value(
         string expr_str, string value_str) override
       { encode('v', "show_value", expr_str+value_str); }
+    void output_benchmark(string code_str, string, string, string, string,
+                          string, string, string, string samples) override {
+      if (samples.empty()) // e.g., from a "with()" loop
+        encode('i', "benchmark", code_str);
+      else
+        encode_benchmark(code_str, samples);
+    }
     void output_begin_with(string var_name,
                            string container_first, string container_rest,
                            string) override
@@ -18,7 +18,21 @@
 #include "testudo_format.h"
 #include "kmsxml.h"
 #include <ostream>
-#include <regex>
+#include <string_view>
+#include <stack>
+#include <sstream>
+#include <iomanip>
+#include <list>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <cstring>
+#include <cstdlib>
+#include <csignal>
+#include <unistd.h>
+#include <pthread.h>
 
 using namespace testudo;
 using namespace kmsxml;
@@ -26,11 +40,35 @@ using namespace std;
 
 namespace testudo___implementation {
 
+  namespace {
+
+    string_view const escaped_tilde="||~tilde~||~";
+
+    // replace all (non-overlapping) instances of "from" in "s" with "to", in
+    // a single pass
+    string replace_all(string const &s, string_view from, string_view to) {
+      auto pos=s.find(from);
+      if (pos==string::npos)
+        return s;
+      string result;
+      result.reserve(s.size());
+      size_t run_begin=0;
+      for (; pos not_eq string::npos; pos=s.find(from, run_begin)) {
+        result.append(s, run_begin, pos-run_begin);
+        result+=to;
+        run_begin=pos+from.size();
+      }
+      result.append(s, run_begin);
+      return result;
+    }
+
+  }
+
   string escape_tilde(string s)
-    { return regex_replace(s, regex("~"), "||~tilde~||~"); }
+    { return replace_all(s, "~", escaped_tilde); }
 
   string unescape_tilde(string s)
-    { return regex_replace(s, regex("\\|\\|~tilde~\\|\\|~"), "~"); }
+    { return replace_all(s, escaped_tilde, "~"); }
 
 }
 
@@ -45,6 +83,13 @@ namespace {
   }
   string xml_bool(string b) { return b; }
 
+  // microsecond resolution is enough to find slow tests
+  string seconds(double s) {
+    ostringstream oss;
+    oss << fixed << setprecision(6) << s;
+    return oss.str();
+  }
+
   class TestFormatXML
     : public TestFormat {
   public:
@@ -58,30 +103,231 @@ namespace {
     // pointers) rather than nodes (weak shared pointers)
     stack<element_t::root_t> test_stack;
     std::size_t test_depth() const { return test_stack.size()-1; }
+    // the output is written into "buffer", and moved from there to "ts"
+    // (and flushed) according to "flush_policy"; what's pending can be read
+    // in place, without allocating, which the crash handler needs
+    struct pending_buffer_t
+      : stringbuf {
+      char const *data() const { return pbase(); }
+      size_t size() const { return static_cast<size_t>(pptr()-pbase()); }
+    } pending;
+    ostream buffer{&pending};
+    void written(bool test_boundary) {
+      switch (flush_policy) {
+      case flush_policy_t::per_element: write_buffer(); break;
+      case flush_policy_t::per_test:
+        if (test_boundary)
+          write_buffer();
+        break;
+      case flush_policy_t::by_size:
+        if (pending.size()>=flush_size)
+          write_buffer();
+        break;
+      default:
+        throw runtime_error("unknown flush policy");
+      }
+    }
+    void write_buffer() {
+      ts.write(pending.data(), streamsize(pending.size()));
+      ts << flush;
+      pending.str({});
+    }
+    bool is_test_boundary(element_t::node_t t) const
+      { return (t->name=="test") or (test_stack.size()==1); }
   public:
     element_t::node_t current_test() { return test_stack.top(); }
-    // after each output, we flush the output in case a crash happens
     void push_open(element_t::root_t t) {
       test_stack.push(t);
-      current_test()->output_begin(ts, test_depth(), true);
-      ts << flush;
+      current_test()->output_begin(buffer, test_depth(), true);
+      ostringstream end;
+      current_test()->output_end(end, test_depth(), true);
+      closing_tags.push_back(end.str());
+      written(is_test_boundary(t));
     }
     void close_pop() {
-      current_test()->output_end(ts, test_depth(), true);
-      ts << flush;
+      current_test()->output_end(buffer, test_depth(), true);
+      closing_tags.pop_back();
+      written(is_test_boundary(current_test()));
       test_stack.pop();
     }
     void print(element_t::node_t t) {
-      t->output(ts, test_depth(), false);
-      ts << flush;
+      t->output(buffer, test_depth(), false);
+      written(false);
     }
 
     ostream &ts;
-    TestFormatXML(ostream &os) : ts(os) { push_open(root); }
+    TestFormatXML(ostream &os)
+      : ts(os), crash_fd((&os==&cout) ? STDOUT_FILENO : -1),
+        owner_pid(getpid()) {
+      push_open(root);
+      add_live_format(this);
+    }
     ~TestFormatXML() {
+      remove_live_format(this);
       close_pop();
+      write_buffer();
+    }
+
+  private:
+    // crash safety: if the process is killed by a crash signal, or exits, in
+    // the middle of the tests, the XML formats alive write what they have
+    // pending, followed by an uncaught exception saying so, and close their
+    // open elements, so that the report is still well formed and shows what
+    // happened; on exit, this is done through the stream, but in the signal
+    // handler, only "write()" is safe, so the bytes are prepared beforehand
+    // (the end tags of the open elements, in "closing_tags", and the uncaught
+    // exception for each signal, in "crash_texts"), and written to the file
+    // descriptor behind the stream, which is only known for "cout"
+    int const crash_fd;
+    // a forked process (e.g., a worker process) mustn't write the formats it
+    // inherited, only those it created itself
+    pid_t const owner_pid;
+    vector<string> closing_tags;
+    // formats are created and destroyed on any thread, and the signal
+    // handler may walk "live_formats" at any time, so it's only accessed
+    // while holding "live_formats_busy"; whoever holds it (but the signal
+    // handler) has the crash signals blocked, so that the signal handler,
+    // waiting for it, is never waiting for its own thread
+    inline static list<TestFormatXML *> live_formats;
+    inline static atomic_flag live_formats_busy=ATOMIC_FLAG_INIT;
+    inline static sigset_t fork_previous_mask;
+    inline static struct sigaction previous_actions[NSIG];
+    // interruptions (SIGINT, SIGTERM...) keep their default action
+    inline static int const crash_signals[]=
+      {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+    inline static string crash_texts[NSIG];
+
+    static string crash_reason(int signal_number) {
+      return
+        "test process killed by signal "+to_string(signal_number)
+        +" ("+strsignal(signal_number)+")";
+    }
+    static string crash_text(int signal_number) {
+      ostringstream text;
+      element_t::make_root("uncaught_exception")
+        ->append_text(escape_tilde(crash_reason(signal_number)))
+        ->output(text, 0, false);
+      return text.str();
     }
 
+    // async-signal-safe
+    static void write_all(int fd, char const *data, size_t size) {
+      while (size>0) {
+        auto written=::write(fd, data, size);
+        if (written<=0)
+          return;
+        data+=written;
+        size-=static_cast<size_t>(written);
+      }
+    }
+    void write_crash(int signal_number) const {
+      if (crash_fd<0)
+        return;
+      write_all(crash_fd, pending.data(), pending.size());
+      static char const spaces[]="                                ";
+      for (auto n=test_depth()*kmsxml::implementation::indent_width; n>0;) {
+        auto chunk=min(n, sizeof(spaces)-1);
+        write_all(crash_fd, spaces, chunk);
+        n-=chunk;
+      }
+      auto const &text=crash_texts[signal_number];
+      write_all(crash_fd, text.data(), text.size());
+      for (auto tag=closing_tags.rbegin(); tag not_eq closing_tags.rend();
+           ++tag)
+        write_all(crash_fd, tag->data(), tag->size());
+    }
+    static sigset_t crash_signal_set() {
+      sigset_t result;
+      sigemptyset(&result);
+      for (auto signal_number: crash_signals)
+        sigaddset(&result, signal_number);
+      return result;
+    }
+    // async-signal-safe
+    static void lock_live_formats() {
+      while (live_formats_busy.test_and_set(memory_order_acquire))
+        ;
+    }
+    static void unlock_live_formats()
+      { live_formats_busy.clear(memory_order_release); }
+    static void block_and_lock(sigset_t &previous_mask) {
+      auto crash_set=crash_signal_set();
+      pthread_sigmask(SIG_BLOCK, &crash_set, &previous_mask);
+      lock_live_formats();
+    }
+    static void unlock_and_unblock(sigset_t const &previous_mask) {
+      unlock_live_formats();
+      pthread_sigmask(SIG_SETMASK, &previous_mask, nullptr);
+    }
+    class live_formats_guard_t {
+    public:
+      live_formats_guard_t() { block_and_lock(previous_mask); }
+      ~live_formats_guard_t() { unlock_and_unblock(previous_mask); }
+    private:
+      sigset_t previous_mask;
+    };
+
+    static void crash_handler(int signal_number) {
+      lock_live_formats();
+      auto pid=getpid();
+      for (auto format: live_formats)
+        if (format->owner_pid==pid)
+          format->write_crash(signal_number);
+      unlock_live_formats();
+      sigaction(signal_number, &previous_actions[signal_number], nullptr);
+      raise(signal_number);
+    }
+
+    void close_on_exit() {
+      uncaught_exception("test process exited");
+      while (not test_stack.empty())
+        close_pop();
+      write_buffer();
+    }
+    static void exit_handler() {
+      list<TestFormatXML *> formats;
+      {
+        live_formats_guard_t guard;
+        auto pid=getpid();
+        for (auto format=live_formats.begin();
+             format not_eq live_formats.end();)
+          if ((*format)->owner_pid==pid)
+            formats.splice(formats.end(), live_formats, format++);
+          else
+            ++format;
+      }
+      for (auto format: formats)
+        format->close_on_exit();
+    }
+    static void add_live_format(TestFormatXML *format) {
+      static bool const handlers_installed=[] {
+        struct sigaction action{};
+        action.sa_handler=crash_handler;
+        sigemptyset(&action.sa_mask);
+        for (auto signal_number: crash_signals) {
+          crash_texts[signal_number]=crash_text(signal_number);
+          sigaction(signal_number, &action,
+                    &previous_actions[signal_number]);
+        }
+        atexit(exit_handler);
+        // a thread forking while another one holds the lock would leave it
+        // held forever in the child process
+        pthread_atfork([] { block_and_lock(fork_previous_mask); },
+                       [] { unlock_and_unblock(fork_previous_mask); },
+                       [] { unlock_and_unblock(fork_previous_mask); });
+        return true;
+      }();
+      (void)handlers_installed;
+      live_formats_guard_t guard;
+      live_formats.push_back(format);
+    }
+    static void remove_live_format(TestFormatXML *format) {
+      live_formats_guard_t guard;
+      live_formats.remove(format);
+    }
+
+  public:
+
     template <typename E> // E is element::root_t or element::node_t
     E localize(E element) {
       element
@@ -187,6 +433,25 @@ namespace {
       print(show_value_element);
     }
 
+    void output_benchmark(string code_str,
+                          string ns_per_op, string ci_low, string ci_high,
+                          string allocations_per_op,
+                          string n_samples, string iterations,
+                          string n_outliers, string samples) override {
+      auto benchmark_element=localize(element_t::make_root("benchmark"));
+      benchmark_element
+        ->append_text(escape_tilde(code_str))
+        ->append_attribute("ns_per_op", ns_per_op)
+        ->append_attribute("ci_low", ci_low)
+        ->append_attribute("ci_high", ci_high)
+        ->append_attribute("allocations_per_op", allocations_per_op)
+        ->append_attribute("samples", n_samples)
+        ->append_attribute("iterations", iterations)
+        ->append_attribute("outliers", n_outliers)
+        ->append_attribute("sample_times", samples);
+      print(benchmark_element);
+    }
+
     void output_begin_with(string var,
                            string container_first, string container_rest,
                            string summary) override {
@@ -221,6 +486,16 @@ namespace {
         ->append_attribute("n_total", to_string(n_total))
         ->append_attribute("n_errors", to_string(n_errors))
         ->append_attribute("success", xml_bool(n_failed+n_errors==0));
+      if (auto timing=get_timing(); not timing.empty()) {
+        general_summary_element
+          ->append_attribute("start", seconds(timing.start))
+          ->append_attribute("end", seconds(timing.end));
+        if (timing.fixture_setup>0.)
+          general_summary_element
+            ->append_attribute("fixture_setup", seconds(timing.fixture_setup))
+            ->append_attribute("fixture_teardown",
+                               seconds(timing.fixture_teardown));
+      }
       print(general_summary_element);
     }
 
@@ -0,0 +1,191 @@
+// Copyright © 2020-2023 Miguel González Cuadrado <mgcuadrado@gmail.com>
+
+// This file is part of Testudo.
+
+//     Testudo is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+
+//     Testudo is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+
+//     You should have received a copy of the GNU General Public License
+//     along with Testudo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "testudo_list.h"
+#include "testudo_format_record.h"
+#include "testudo_durations.h"
+#include "testudo_manifest.h"
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <cstdint>
+#include <cstdio>
+
+namespace testudo___implementation {
+
+  using namespace std;
+
+  namespace {
+
+    // see "testudo_list.h" for the layout
+    string const list_magic="testudo-list-2\n";
+
+    // flags of an encoded entry
+    uint8_t const with_priority=1, with_duration=2;
+
+    template <typename T>
+    void encode_raw(T const &value, string &buffer)
+      { encode_le(value, buffer); }
+
+    template <typename T>
+    T decode_raw(string const &buffer, size_t &pos) {
+      if (buffer.size()-pos<sizeof(T))
+        throw runtime_error("truncated Testudo binary list");
+      auto value=decode_le<T>(buffer.data()+pos);
+      pos+=sizeof(T);
+      return value;
+    }
+
+    void write_json_string(ostream &os, string const &s) {
+      os << '"';
+      for (char c: s)
+        switch (c) {
+        case '"': os << "\\\""; break;
+        case '\\': os << "\\\\"; break;
+        case '\n': os << "\\n"; break;
+        case '\t': os << "\\t"; break;
+        default:
+          if (static_cast<unsigned char>(c)<0x20) {
+            char escaped[7];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            os << escaped;
+          }
+          else
+            os << c;
+          break;
+        }
+      os << '"';
+    }
+
+  }
+
+  list_entries_t list_entries(TestNode const &node,
+                              list<name_t> const &include,
+                              list<string> const &glob,
+                              durations_t const &durations) {
+    list_entries_t result;
+    for (auto const &[listed, runs_test]: node.list_nodes(include, glob)) {
+      list_entry_t entry{listed->full_name, listed->get_title(),
+                         listed->location, listed->get_priority(),
+                         runs_test
+                         ? (listed->is_benchmark() ? "benchmark" : "test")
+                         : "node",
+                         {}};
+      if (auto found=durations.find(listed->full_name);
+          found not_eq durations.end())
+        entry.duration=found->second;
+      result.push_back(move(entry));
+    }
+    return result;
+  }
+
+  void write_json_lines(ostream &os, list_entries_t const &entries) {
+    for (auto const &e: entries) {
+      os << "{\"name\":";
+      write_json_string(os, e.full_name);
+      os << ",\"title\":";
+      write_json_string(os, e.title);
+      os << ",\"file\":";
+      write_json_string(os, e.location.file);
+      os << ",\"line\":";
+      if (e.location.line.empty())
+        os << "null";
+      else
+        os << e.location.line;
+      os << ",\"priority\":";
+      if (e.priority)
+        os << *e.priority;
+      else
+        os << "null";
+      os << ",\"kind\":";
+      write_json_string(os, e.kind);
+      os << ",\"duration\":";
+      if (e.duration)
+        os << *e.duration;
+      else
+        os << "null";
+      os << "}\n";
+    }
+  }
+
+  void write_binary_list(ostream &os, list_entries_t const &entries) {
+    string buffer=list_magic;
+    encoding_string_table_t string_table;
+    for (auto const &e: entries) {
+      encode_raw(uint8_t((e.priority ? with_priority : 0)
+                         | (e.duration ? with_duration : 0)),
+                 buffer);
+      for (auto const &s: {e.full_name, e.title,
+                           e.location.file, e.location.line, e.kind})
+        string_table.encode(s, buffer);
+      if (e.priority)
+        encode_raw(uint64_t(*e.priority), buffer);
+      if (e.duration)
+        encode_raw(*e.duration, buffer);
+    }
+    os.write(buffer.data(), streamsize(buffer.size()));
+  }
+
+  list_entries_t read_binary_list(istream &is) {
+    string buffer{istreambuf_iterator<char>(is), istreambuf_iterator<char>()};
+    if (buffer.compare(0, list_magic.size(), list_magic) not_eq 0)
+      throw runtime_error("not a Testudo binary list");
+    list_entries_t result;
+    decoding_string_table_t string_table;
+    for (size_t pos=list_magic.size(); pos<buffer.size(); ) {
+      auto flags=decode_raw<uint8_t>(buffer, pos);
+      list_entry_t e;
+      e.full_name=string_table.decode(buffer, pos);
+      e.title=string_table.decode(buffer, pos);
+      e.location.file=string_table.decode(buffer, pos);
+      e.location.line=string_table.decode(buffer, pos);
+      e.kind=string_table.decode(buffer, pos);
+      if (flags & with_priority)
+        e.priority=TestNode::priority_t(decode_raw<uint64_t>(buffer, pos));
+      if (flags & with_duration)
+        e.duration=decode_raw<double>(buffer, pos);
+      result.push_back(move(e));
+    }
+    return result;
+  }
+
+  void testudo_list(opts_t opts) {
+    TestOptions to(opts);
+    if ((to.format_name not_eq "jsonl") and (to.format_name not_eq "binary")) {
+      cerr << "error; format: "
+           << opts.executable << " list -f jsonl|binary" << endl;
+      exit(1);
+    }
+    if (not load_selected_test_libraries(to, to.subtree))
+      exit(2);
+    auto root=testudo__TOP_TEST_NODE(to.subtree);
+    if (not root) {
+      cerr << opts.executable << ": unknown node \"" << to.subtree << "\""
+           << endl;
+      exit(1);
+    }
+    auto entries=
+      list_entries(*root, to.include, to.glob,
+                   to.durations_file.empty()
+                   ? durations_t{} : read_durations(to.durations_file));
+    if (to.format_name=="jsonl")
+      write_json_lines(cout, entries);
+    else
+      write_binary_list(cout, entries);
+  }
+
+}
@@ -0,0 +1,81 @@
+// Copyright © 2020-2023 Miguel González Cuadrado <mgcuadrado@gmail.com>
+
+// This file is part of Testudo.
+
+//     Testudo is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+
+//     Testudo is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+
+//     You should have received a copy of the GNU General Public License
+//     along with Testudo.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MGCUADRADO_TESTUDO_LIST_HEADER_
+#define MGCUADRADO_TESTUDO_LIST_HEADER_
+
+#include "testudo_opt.h"
+#include "testudo.h"
+#include <istream>
+#include <ostream>
+#include <optional>
+#include <vector>
+
+namespace testudo___implementation {
+
+  // a test node, as listed by "testudo list"; "kind" is "test" or
+  // "benchmark" if the node's own test function would be run, and "node"
+  // otherwise
+  struct list_entry_t {
+    name_t full_name;
+    title_t title;
+    TestFormat::location_t location;
+    std::optional<TestNode::priority_t> priority;
+    std::string kind;
+    std::optional<double> duration;
+  };
+  using list_entries_t=std::vector<list_entry_t>;
+
+  // the nodes "node->test(format, include, glob)" would output, with their
+  // durations, if any, in "durations"
+  list_entries_t list_entries(TestNode const &node,
+                              std::list<name_t> const &include,
+                              std::list<std::string> const &glob,
+                              durations_t const &durations);
+
+  // JSON Lines: an object per line, per node, with "name" (full name),
+  // "title", "file", "line", "priority" (null for declaration-ordered
+  // nodes), "kind", and "duration" (in seconds, or null if unknown)
+  void write_json_lines(std::ostream &, list_entries_t const &);
+  // a compact binary encoding, with a string table for the whole listing,
+  // portable across machines; numbers are little-endian, of the width given
+  // (see "encode_le()"):
+  //
+  //     listing: "testudo-list-2\n" entry*
+  //     entry:   flags:u8 full_name:string title:string file:string
+  //              line:string kind:string [priority:u64] [duration:f64]
+  //     string:  index:u32 [size:u64 byte*]
+  //
+  // "priority" is there if "flags" has bit 0 set, and "duration" (in
+  // seconds) if it has bit 1 set; strings are numbered from 0 in order of
+  // appearance, and only the first appearance of each one has its size and
+  // bytes; "read_binary_list()" throws if the stream isn't in that format
+  void write_binary_list(std::ostream &, list_entries_t const &);
+  list_entries_t read_binary_list(std::istream &);
+
+  // list the test nodes, as "testudo run" would select them, without
+  // running them; the format is either "jsonl" or "binary"; durations are
+  // those in the durations file, if any:
+  //
+  //     testudo list -f jsonl|binary [-s <subtree>] [-i <node>]...
+  //                  [-g <glob>]... [-t <durations_file>]
+  //                  [-m <manifest_file>] <library>...
+  void testudo_list(opts_t);
+
+}
+
+#endif
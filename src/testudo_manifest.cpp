@@ -0,0 +1,181 @@
+// Copyright © 2020-2023 Miguel González Cuadrado <mgcuadrado@gmail.com>
+
+// This file is part of Testudo.
+
+//     Testudo is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+
+//     Testudo is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+
+//     You should have received a copy of the GNU General Public License
+//     along with Testudo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "testudo_manifest.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <stdexcept>
+
+namespace testudo___implementation {
+
+  using namespace std;
+
+  namespace {
+
+    namespace fs=std::filesystem;
+
+    // whether "name" is "ancestor", or a descendant of it
+    bool is_in_subtree(name_t const &name, name_t const &ancestor) {
+      return
+        ancestor.empty()
+        or ((name.compare(0, ancestor.size(), ancestor)==0)
+            and ((name.size()==ancestor.size())
+                 or (name[ancestor.size()]=='.')));
+    }
+
+    // whether a manifest file is there, and has every library, and no
+    // library has changed since it was written
+    bool is_up_to_date(manifest_t const &manifest, string const &filename,
+                       list<string> const &libraries) {
+      error_code ec;
+      auto manifest_time=fs::last_write_time(filename, ec);
+      if (ec)
+        return false;
+      for (auto const &library: libraries) {
+        if (not manifest.count(library))
+          return false;
+        auto library_time=fs::last_write_time(library, ec);
+        if (ec or (library_time>manifest_time))
+          return false;
+      }
+      return true;
+    }
+
+  }
+
+  manifest_t read_manifest(string filename) {
+    manifest_t result;
+    ifstream is(filename);
+    string library, name;
+    while (getline(is, library, '\t') and getline(is, name)) {
+      auto &names=result[library];
+      // libraries that define no node are kept with an empty name
+      if (not name.empty())
+        names.insert(name);
+    }
+    if (is.bad() or not (is.eof() or result.empty()))
+      throw runtime_error("wrong format in manifest file \""+filename+"\"");
+    return result;
+  }
+
+  void write_manifest(string filename, manifest_t const &manifest) {
+    ofstream os(filename);
+    for (auto const &[library, names]: manifest) {
+      if (names.empty())
+        os << library << '\t' << '\n';
+      for (auto const &name: names)
+        os << library << '\t' << name << '\n';
+    }
+    if (not os)
+      throw runtime_error("couldn't write manifest file \""+filename+"\"");
+  }
+
+  bool load_test_libraries(list<string> const &libraries,
+                           manifest_t &manifest) {
+    auto &observer=TestNode::registration_observer();
+    for (auto const &library: libraries) {
+      auto &names=manifest[library];
+      names.clear();
+      observer=[&names](TestNode const &node)
+                 { names.insert(node.full_name); };
+      bool loaded=load_test_libraries({library});
+      observer=nullptr;
+      if (not loaded)
+        return false;
+    }
+    return true;
+  }
+
+  list<string> needed_libraries(manifest_t const &manifest,
+                                list<string> const &libraries,
+                                name_t const &subtree,
+                                list<name_t> const &include) {
+    // the report has the nodes in the included subtrees, and their
+    // ancestors up to "subtree"
+    list<name_t> included;
+    for (auto const &i: include)
+      included.push_back(subtree.empty() ? i : subtree+"."+i);
+    if (included.empty())
+      included.push_back(subtree);
+    auto is_needed=
+      [&](name_t const &name) {
+        if (not is_in_subtree(name, subtree))
+          return false;
+        for (auto const &i: included)
+          if (is_in_subtree(name, i) or is_in_subtree(i, name))
+            return true;
+        return false;
+      };
+    list<string> result;
+    for (auto const &library: libraries) {
+      // libraries that define no node are there for other libraries to use
+      auto found=manifest.find(library);
+      bool needed=(found==manifest.end()) or found->second.empty();
+      if (not needed)
+        for (auto const &name: found->second)
+          if (is_needed(name)) {
+            needed=true;
+            break;
+          }
+      if (needed)
+        result.push_back(library);
+    }
+    return result;
+  }
+
+  bool load_selected_test_libraries(TestOptions const &to,
+                                    name_t const &subtree) {
+    if (to.manifest_file.empty())
+      return load_test_libraries(to.dynamic_libraries);
+    auto manifest=read_manifest(to.manifest_file);
+    if (not is_up_to_date(manifest, to.manifest_file, to.dynamic_libraries)) {
+      // the entries of other libraries are kept
+      if (not load_test_libraries(to.dynamic_libraries, manifest))
+        return false;
+      write_manifest(to.manifest_file, manifest);
+      return true;
+    }
+    return
+      load_test_libraries(
+        to.changed_files.empty()
+        ? needed_libraries(manifest, to.dynamic_libraries, subtree,
+                           to.include)
+        : to.dynamic_libraries);
+  }
+
+  void testudo_manifest(opts_t opts) {
+    string manifest_file;
+    list<string> libraries;
+    while (opts) {
+      if (auto m=opts.opt_arg("-m"))
+        manifest_file=m;
+      else
+        libraries.push_back(opts.arg());
+    }
+    if (manifest_file.empty()) {
+      cerr << "error; manifest: "
+           << opts.executable << " manifest -m <manifest_file>" << endl;
+      exit(1);
+    }
+    manifest_t manifest;
+    if (not load_test_libraries(libraries, manifest))
+      exit(2);
+    write_manifest(manifest_file, manifest);
+  }
+
+}
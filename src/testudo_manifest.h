@@ -0,0 +1,74 @@
+// Copyright © 2020-2023 Miguel González Cuadrado <mgcuadrado@gmail.com>
+
+// This file is part of Testudo.
+
+//     Testudo is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+
+//     Testudo is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+
+//     You should have received a copy of the GNU General Public License
+//     along with Testudo.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MGCUADRADO_TESTUDO_MANIFEST_HEADER_
+#define MGCUADRADO_TESTUDO_MANIFEST_HEADER_
+
+#include "testudo_opt.h"
+#include "testudo.h"
+#include <string>
+#include <list>
+#include <map>
+#include <set>
+
+namespace testudo___implementation {
+
+  // a manifest keeps, for each test library, the full names of the test
+  // nodes it creates or sets when it's loaded; manifest files are text
+  // files with a line per library and node, with the library, a tab, and
+  // the node's full name (up to the end of the line), or nothing, for
+  // libraries that define no node; a missing file reads as an empty
+  // manifest
+  using manifest_t=std::map<std::string, std::set<name_t>>;
+  manifest_t read_manifest(std::string filename);
+  void write_manifest(std::string filename, manifest_t const &manifest);
+
+  // like "load_test_libraries()", but adding, for each library, the nodes
+  // it defines to "manifest"
+  bool load_test_libraries(std::list<std::string> const &libraries,
+                           manifest_t &manifest);
+
+  // the libraries, among "libraries", that a run from "subtree", including
+  // only "include" (relative to "subtree", as usual), needs: those that
+  // define nodes the report would have (the nodes in the included subtrees,
+  // and their ancestors up to "subtree"), those not in the manifest, and
+  // those that define no node (since they're there for other libraries to
+  // use)
+  std::list<std::string> needed_libraries(
+    manifest_t const &manifest,
+    std::list<std::string> const &libraries,
+    name_t const &subtree,
+    std::list<name_t> const &include);
+
+  // load the test libraries a run needs, according to the options; without
+  // a manifest file, that's all of them; with one that is missing some
+  // library, or older than some library, all of them are loaded, and the
+  // manifest file is updated; otherwise, only the needed libraries are
+  // loaded (all of them, though, if "-c" is given, since every test node is
+  // needed to work out which are affected); on failure, report the error,
+  // and return false
+  bool load_selected_test_libraries(TestOptions const &,
+                                    name_t const &subtree);
+
+  // (re)write the manifest file for the given test libraries:
+  //
+  //     testudo manifest -m <manifest_file> <library>...
+  void testudo_manifest(opts_t);
+
+}
+
+#endif
@@ -0,0 +1,176 @@
+// Copyright © 2020-2023 Miguel González Cuadrado <mgcuadrado@gmail.com>
+
+// This file is part of Testudo.
+
+//     Testudo is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+
+//     Testudo is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+
+//     You should have received a copy of the GNU General Public License
+//     along with Testudo.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "testudo_merge.h"
+#include "testudo_format_binary.h"
+#include "testudo.h"
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+#include <map>
+
+namespace testudo___implementation {
+
+  using namespace std;
+
+  namespace {
+
+    using ev=test_format_event_t;
+
+    // what the reports say about a test node's own test function: its
+    // output, from the report where it was run (i.e., everything between the
+    // mark of its start and the node's summary), and its stats (i.e., its
+    // summary stats minus its children's)
+    struct own_test_t {
+      test_format_events_t events;
+      TestStats stats;
+      // the report where the test function was run, if any
+      string report_filename;
+    };
+    using own_tests_t=map<name_t, own_test_t>;
+
+    bool block_starts_at(test_format_events_t const &events, size_t pos) {
+      return
+        (pos+1<events.size())
+        and (events[pos].kind==ev::set_title_location)
+        and (events[pos+1].kind==ev::output_title);
+    }
+
+    // parse the block for a test node, as output by "TestNode::run_tests()":
+    // title location and title, children blocks, the mark of the start of
+    // the own test function and its events (if it was run), the node's
+    // timing, and summary; return the node's summary stats; a test function
+    // can be run in only one of the reports
+    TestStats parse_block(test_format_events_t const &events, size_t &pos,
+                          own_tests_t &own_tests,
+                          string const &report_filename) {
+      auto name=events.at(pos+1).args.at(0);
+      pos+=2;
+      auto &own_test=own_tests[name];
+      TestStats children_stats;
+      test_format_events_t own_events;
+      bool run=false;
+      while (true) {
+        if (pos>=events.size())
+          throw runtime_error("unfinished test node \""+name+"\" in report");
+        else if (block_starts_at(events, pos))
+          children_stats+=
+            parse_block(events, pos, own_tests, report_filename);
+        else if (events[pos].kind==ev::start_test_function) {
+          // not kept: replaying the merged tree marks it again
+          run=true;
+          ++pos;
+        }
+        else if (events[pos].kind==ev::produce_summary)
+          break;
+        else
+          own_events.push_back(events[pos++]);
+      }
+      auto summary_stats=events[pos++].test_stats;
+      // without its test function, all that's left of a node is its timing,
+      // which is worked out again when replaying the merged tree
+      if (run) {
+        if (not own_test.report_filename.empty())
+          throw runtime_error("test node \""+name+"\" run in both \""
+                              +own_test.report_filename+"\" and \""
+                              +report_filename+"\"");
+        own_test.report_filename=report_filename;
+        own_test.events=move(own_events);
+      }
+      own_test.stats+=summary_stats-children_stats;
+      return summary_stats;
+    }
+
+    // the reports must have been produced from the test tree in the
+    // libraries
+    TestNode::sptr node_named(name_t const &full_name) {
+      auto node=TestNode::find_node(full_name);
+      if (not node)
+        throw runtime_error("unknown test node \""+full_name+"\" in reports");
+      return node;
+    }
+
+  }
+
+  void testudo_merge(opts_t opts) {
+    string format_name;
+    list<string> report_filenames, libraries;
+    while (opts) {
+      if (auto f=opts.opt_arg("-f"))
+        format_name=f;
+      else if (auto r=opts.opt_arg("-r"))
+        report_filenames.push_back(r);
+      else if (auto d=opts.opt_arg("-d"))
+        TestFormat::location_t::common_directory=d;
+      else
+        libraries.push_back(opts.arg());
+    }
+    if (format_name.empty() or report_filenames.empty()) {
+      cerr << "error; usage: " << opts.executable
+           << " merge -f <test_output_format> -r <binary_report>..."
+           << " <library>..." << endl;
+      exit(1);
+    }
+    if (not load_test_libraries(libraries))
+      exit(2);
+
+    own_tests_t own_tests;
+    string root_name;
+    TestNode::selection_t selection;
+    // a bad merge must fail the command, rather than print an empty
+    // report, so that scripts merging shard reports notice it
+    try {
+      bool first=true;
+      for (auto const &report_filename: report_filenames) {
+        ifstream is(report_filename, ios::binary);
+        if (not is)
+          throw runtime_error("cannot open \""+report_filename+"\"");
+        auto events=read_binary_events(is);
+        if (not block_starts_at(events, 0))
+          throw runtime_error("no test node in \""+report_filename+"\"");
+        auto report_root_name=events[1].args.at(0);
+        if (first)
+          root_name=report_root_name;
+        else if (report_root_name not_eq root_name)
+          throw runtime_error("reports for different test nodes (\""
+                              +root_name+"\" and \""+report_root_name+"\")");
+        first=false;
+        size_t pos=0;
+        parse_block(events, pos, own_tests, report_filename);
+      }
+      // nodes whose test function was run nowhere are still traversed, for
+      // their children's sake
+      for (auto const &[name, own_test]: own_tests)
+        selection[node_named(name).get()]=
+          not own_test.report_filename.empty();
+    }
+    catch (exception const &e) {
+      cerr << opts.executable << ": " << e.what() << endl;
+      exit(1);
+    }
+
+    node_named(root_name)
+      ->replay(test_format_named_creator(format_name)(cout), selection,
+               [&own_tests](TestNode const &node,
+                            test_management_t test_management) {
+                 auto const &own_test=own_tests.at(node.full_name);
+                 replay(own_test.events, *test_management.format);
+                 test_management.stats+=own_test.stats;
+               });
+  }
+
+}
@@ -0,0 +1,34 @@
+// Copyright © 2020-2023 Miguel González Cuadrado <mgcuadrado@gmail.com>
+
+// This file is part of Testudo.
+
+//     Testudo is free software: you can redistribute it and/or modify
+//     it under the terms of the GNU General Public License as published by
+//     the Free Software Foundation, either version 3 of the License, or
+//     (at your option) any later version.
+
+//     Testudo is distributed in the hope that it will be useful,
+//     but WITHOUT ANY WARRANTY; without even the implied warranty of
+//     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//     GNU General Public License for more details.
+
+//     You should have received a copy of the GNU General Public License
+//     along with Testudo.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MGCUADRADO_TESTUDO_MERGE_HEADER_
+#define MGCUADRADO_TESTUDO_MERGE_HEADER_
+
+#include "testudo_opt.h"
+
+namespace testudo___implementation {
+
+  // merge binary reports (e.g., from the shards of a sharded run) into a
+  // single report, in any format, equivalent to that of a single run; the
+  // test libraries must be supplied too, so that the test tree is known:
+  //
+  //     testudo merge -f <format> -r <binary_report>... <library>...
+  void testudo_merge(opts_t);
+
+}
+
+#endif
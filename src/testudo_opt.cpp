@@ -20,8 +20,16 @@
 #include "testudo_help.h"
 #include "testudo_diff.h"
 #include "testudo_xml_to_color.h"
+#include "testudo_merge.h"
+#include "testudo_affected.h"
+#include "testudo_list.h"
+#include "testudo_manifest.h"
+#include "testudo_format_binary.h"
+#include "testudo_durations.h"
 #include "testudo.h"
 #include <iostream>
+#include <thread>
+#include <algorithm>
 #include <dlfcn.h>
 #include <cassert>
 
@@ -76,6 +84,56 @@ namespace testudo___implementation {
         glob.push_back(g);
       else if (auto d=opts.opt_arg("-d"))
         TestFormat::location_t::common_directory=d;
+      else if (auto j=opts.opt_arg("-j")) {
+        // "-j 0" means as many jobs as hardware threads
+        jobs=static_cast<unsigned>(stoul(j));
+        if (jobs==0)
+          jobs=max(1u, thread::hardware_concurrency());
+      }
+      else if (opts.opt("-p"))
+        isolated=true;
+      else if (auto t=opts.opt_arg("--timeout"))
+        timeout=stod(t);
+      else if (auto sh=opts.opt_arg("--shard")) {
+        auto slash=sh.find('/');
+        if (slash not_eq string::npos) {
+          shard=static_cast<unsigned>(stoul(sh.substr(0, slash)));
+          n_shards=static_cast<unsigned>(stoul(sh.substr(slash+1)));
+        }
+        if ((slash==string::npos) or (shard<1) or (shard>n_shards)) {
+          cerr << "error; shard: "
+               << opts.executable << " --shard <shard>/<number_of_shards>"
+               << " (with 1 <= <shard> <= <number_of_shards>)" << endl;
+          exit(1);
+        }
+      }
+      else if (auto t=opts.opt_arg("-t"))
+        durations_file=t;
+      else if (auto c=opts.opt_arg("-c"))
+        changed_files.push_back(c);
+      else if (auto m=opts.opt_arg("-M"))
+        dependencies_directory=m;
+      else if (auto m=opts.opt_arg("-m"))
+        manifest_file=m;
+      else if (auto b=opts.opt_arg("--baseline"))
+        baseline_file=b;
+      else if (auto b=opts.opt_arg("--save-baseline"))
+        save_baseline_file=b;
+      else if (auto t=opts.opt_arg("-T")) {
+        TestFormat::show_timing=true;
+        TestFormat::n_slowest_tests=static_cast<unsigned>(stoul(t));
+      }
+      else if (auto f=opts.opt_arg("--flush")) {
+        // "element", "test", or a size in bytes
+        if (f=="element")
+          TestFormat::flush_policy=TestFormat::flush_policy_t::per_element;
+        else if (f=="test")
+          TestFormat::flush_policy=TestFormat::flush_policy_t::per_test;
+        else {
+          TestFormat::flush_policy=TestFormat::flush_policy_t::by_size;
+          TestFormat::flush_size=stoul(f);
+        }
+      }
       else
         dynamic_libraries.push_back(opts.arg());
     }
@@ -87,6 +145,18 @@ namespace testudo___implementation {
     }
   }
 
+  bool load_test_libraries(list<string> const &libraries) {
+    for (string library: libraries) {
+      dlopen(library.c_str(), RTLD_LAZY | RTLD_GLOBAL);
+      if (auto error=dlerror()) {
+        cerr << "dlopen() error opening \""+library+"\": "
+                  << error << endl;
+        return false;
+      }
+    }
+    return true;
+  }
+
   int testudo_main(std::string subtree, main_params) {
     begintrycatch;
     auto opts=testudo::args_to_opts(main_args);
@@ -99,24 +169,72 @@ namespace testudo___implementation {
       testudo___implementation::testudo_diff(opts);
     else if (command=="xml_to_color")
       testudo___implementation::testudo_xml_to_color(opts);
+    else if (command=="merge")
+      testudo___implementation::testudo_merge(opts);
+    else if (command=="affected")
+      testudo___implementation::testudo_affected(opts);
+    else if (command=="list")
+      testudo___implementation::testudo_list(opts);
+    else if (command=="manifest")
+      testudo___implementation::testudo_manifest(opts);
+    else if (command=="binary_to_xml")
+      testudo___implementation::testudo_binary_to("xml", opts);
+    else if (command=="binary_to_color")
+      testudo___implementation::testudo_binary_to("color_text", opts);
+    else if (command=="binary_to_track")
+      testudo___implementation::testudo_binary_to("track", opts);
     else if (command=="run") {
       testudo::TestOptions to(opts);
-      for (string library: to.dynamic_libraries) {
-        dlopen(library.c_str(), RTLD_LAZY | RTLD_GLOBAL);
-        if (auto error=dlerror()) {
-          cerr << "dlopen() error opening \""+library+"\": "
-                    << error << endl;
-          return 2;
+      if (not to.subtree.empty())
+        subtree=to.subtree;
+      if (not load_selected_test_libraries(to, subtree))
+        return 2;
+      auto test_root=testudo__TOP_TEST_NODE(subtree);
+      if (test_root and not to.changed_files.empty()) {
+        auto affected=
+          affected_include(*test_root,
+                           read_dependencies(to.dependencies_directory),
+                           to.dynamic_libraries, to.changed_files,
+                           to.include);
+        if (affected.empty()) {
+          clog << opts.executable << ": no test affected by the changed files"
+               << endl;
+          return 0;
         }
+        to.include=affected;
       }
-      auto test_root=
-        testudo__TOP_TEST_NODE(to.subtree.empty() ? subtree : to.subtree);
-      if (test_root)
+      if (test_root) {
+        durations_t durations;
+        if (not to.durations_file.empty())
+          durations=read_durations(to.durations_file);
+        if (not to.baseline_file.empty())
+          benchmark_baseline()=read_durations(to.baseline_file);
+        run_makespan_t run_makespan;
         test_root
           ->test(testudo::test_format_named_creator(to.format_name)(cout),
-                 to.include, to.glob);
+                 to.include, to.glob,
+                 {to.jobs, to.isolated, to.shard, to.n_shards,
+                  to.durations_file.empty() ? nullptr : &durations,
+                  &run_makespan, to.timeout});
+        // test functions that weren't run keep their previous durations
+        if (not to.durations_file.empty()) {
+          write_durations(to.durations_file, durations);
+          clog << opts.executable << ": ";
+          if (run_makespan.predicted)
+            clog << "predicted duration " << *run_makespan.predicted
+                 << " s, ";
+          clog << "actual duration " << run_makespan.actual << " s" << endl;
+        }
+        // likewise, benchmarks that weren't run keep their previous times
+        if (not to.save_baseline_file.empty()) {
+          auto baseline=read_durations(to.save_baseline_file);
+          for (auto const &[key, seconds]: benchmark_measurements())
+            baseline[key]=seconds;
+          write_durations(to.save_baseline_file, baseline);
+        }
+      }
       else {
-        cerr << opts.executable << ": unknown node \"" << to.subtree << "\""
+        cerr << opts.executable << ": unknown node \"" << subtree << "\""
                   << endl;
         return 1;
       }
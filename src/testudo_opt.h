@@ -55,8 +55,26 @@ namespace testudo___implementation {
     std::list<std::string> dynamic_libraries;
     std::string subtree;
     std::list<std::string> include, glob;
+    unsigned jobs=1; // number of threads (or processes) for test functions
+    bool isolated=false; // whether to run test functions in worker processes
+    double timeout=0.; // if positive, seconds before killing a worker process
+    unsigned shard=1, n_shards=1; // run only this part of the test functions
+    std::string durations_file; // durations from and for other runs
+    // benchmark times to compare against, and where to save this run's
+    std::string baseline_file, save_baseline_file;
+    // run only the test nodes affected by these files, according to the
+    // dependencies in that directory
+    std::list<std::string> changed_files;
+    std::string dependencies_directory=".depend";
+    // which test libraries define which test nodes, so that only those
+    // needed are loaded
+    std::string manifest_file;
   };
 
+  // "dlopen()" the test libraries, so that their tests are added to the
+  // test tree; on failure, report the error, and return false
+  bool load_test_libraries(std::list<std::string> const &libraries);
+
   int testudo_main(std::string subtree, main_params);
   inline int testudo_main(main_params) { return testudo_main("", main_args); }
 
@@ -18,6 +18,10 @@
 #include "testudo_typeset_color_text.h"
 #include "testudo_format.h"
 #include <regex>
+#include <optional>
+#include <vector>
+#include <algorithm>
+#include <iomanip>
 
 namespace {
 
@@ -49,6 +53,7 @@ namespace {
       check_ident, check_equal_sign, check_approx_sign, check_max_error,
       check_with_sign,
       show_ident, show_sep, show_tab, show_cont,
+      benchmark_ident,
       name_open, name_close,
       loc_begin, loc_end;
     string ok_label, fail_label, error_label, abort_label;
@@ -105,6 +110,7 @@ namespace {
     color.show_sep=add_color(":");
     color.show_tab=add_color("|");
     color.show_cont=color.ident+"\\";
+    color.benchmark_ident=add_color("@");
     color.name_open=color.ident+"{";
     color.name_close="}"+color.normal;
     color.loc_begin=color.lines;
@@ -182,6 +188,18 @@ namespace {
     return result;
   }
 
+  string format_duration(double seconds) {
+    ostringstream oss;
+    oss << fixed;
+    if (seconds>=1.)
+      oss << setprecision(2) << seconds << " s";
+    else if (seconds>=1e-3)
+      oss << setprecision(2) << seconds*1e3 << " ms";
+    else
+      oss << setprecision(0) << seconds*1e6 << " us";
+    return oss.str();
+  }
+
   string stat_summary(string n_failed, string n_total, string n_errors) {
     string result=n_failed+"/"+n_total+" fail";
     if (n_errors not_eq "0")
@@ -307,6 +325,59 @@ namespace {
       format_label(stream, text, '-', color.abort_label,
                    color.failure, color.normal);
     }
+
+    // the duration for the next summary, if given; whether each open test
+    // has children; and the durations of the tests without children
+    optional<double> next_duration;
+    vector<bool> has_children;
+    vector<pair<double, string>> leaf_durations;
+
+    void set_next_duration(double seconds) { next_duration=seconds; }
+
+    void open_test_timing() {
+      if (not has_children.empty())
+        has_children.back()=true;
+      has_children.push_back(false);
+    }
+    // the duration column for the summary of a "with()" loop
+    string duration_column() {
+      if (not next_duration)
+        return "";
+      string result=
+        " "+color.ident+"("+format_duration(*next_duration)+")"+color.normal;
+      next_duration.reset();
+      return result;
+    }
+    // the duration column for the summary of a test
+    string close_test_timing(string name) {
+      bool leaf=not (has_children.empty() or has_children.back());
+      if (not has_children.empty())
+        has_children.pop_back();
+      if (leaf and next_duration)
+        leaf_durations.emplace_back(*next_duration, name);
+      return duration_column();
+    }
+
+    void format_slowest_tests(ostream &stream, unsigned n) {
+      if ((n==0) or leaf_durations.empty())
+        return;
+      stable_sort(leaf_durations.begin(), leaf_durations.end(),
+                  [](auto const &d1, auto const &d2)
+                    { return d1.first>d2.first; });
+      if (leaf_durations.size()>n)
+        leaf_durations.resize(n);
+      stream << color.name_open << "slowest tests" << color.name_close
+             << endl;
+      for (auto const &[seconds, name]: leaf_durations) {
+        string duration=format_duration(seconds);
+        stream << "  "
+               << (duration.length()<10 ? pad(10-duration.length()) : "")
+               << color.ident << duration << color.normal
+               << "  " << name << endl;
+      }
+      stream << endl;
+      leaf_durations.clear();
+    }
   };
 
   class ColorTextReportTypeset
@@ -338,6 +409,7 @@ namespace {
     void interactive_test() override { format_text(ts, "interactive test"); }
 
     void title(string location, string name, string title) override {
+      open_test_timing();
       string title_location=show_location ? location : "";
       string brief_name=
         ((name.length() > title.length())
@@ -481,6 +553,25 @@ namespace {
       }
     }
 
+    void benchmark(string code_str,
+                   string ns_per_op, string ci_low, string ci_high,
+                   string allocations_per_op,
+                   string n_samples, string iterations,
+                   string n_outliers) override {
+      ostringstream oss;
+      oss << color.benchmark_ident << " " << code_str;
+      if (not ns_per_op.empty())
+        oss << " " << color.show_sep << " " << ns_per_op << " ns/op in ["
+            << ci_low << ", " << ci_high << "], "
+            << (allocations_per_op.empty()
+                ? "allocations not counted"
+                : allocations_per_op+" allocs/op")
+            << " ("
+            << n_samples << " samples of " << iterations << " runs, "
+            << n_outliers << " outliers)";
+      format_text(ts, oss.str());
+    }
+
     void begin_with(string var_name,
                     string container_first, string container_rest) override {
       ostringstream oss;
@@ -502,17 +593,25 @@ namespace {
     void summary(string name,
                  string n_failed, string n_total, string n_errors,
                  string success) override {
-      with_summary(name, n_failed, n_total, n_errors, success);
+      general_summary(name, n_failed, n_total, n_errors, success,
+                      close_test_timing(name));
       ts << endl;
     }
 
     void with_summary(string name,
                       string n_failed, string n_total, string n_errors,
                       string success) override {
+      general_summary(name, n_failed, n_total, n_errors, success,
+                      duration_column());
+    }
+
+    void general_summary(string name,
+                         string n_failed, string n_total, string n_errors,
+                         string success, string duration) {
       ostringstream oss;
       oss << color.name_open << name << color.name_close << " ";
       oss << color.ident << stat_summary(n_failed, n_total, n_errors)
-          << color.normal;
+          << color.normal << duration;
       if (n_errors not_eq "0")
         format_error(ts, oss.str());
       else
@@ -634,6 +733,9 @@ namespace {
                    (color.catch_ident+" aborted "
                     +color.catch_begin+" "+message+" "+color.catch_end));
     }
+
+    void timing(double seconds) override { set_next_duration(seconds); }
+    void slowest_tests(unsigned n) override { format_slowest_tests(ts, n); }
   };
 
   class ColorTextSummaryTypeset
@@ -652,6 +754,7 @@ namespace {
     void interactive_test() override { format_text(ts, "interactive test"); }
 
     void title(string, string name, string) override {
+      open_test_timing();
       test_stack.emplace_back();
       test_stack.back().first=name;
       increase_indent();
@@ -661,6 +764,7 @@ namespace {
                  string success) override {
       decrease_indent();
       assert(test_stack.back().first==name);
+      string duration=close_test_timing(name);
 
       if (auto last_dot=name.rfind('.'); last_dot not_eq string::npos)
         name="-"+name.substr(last_dot);
@@ -668,7 +772,7 @@ namespace {
         color.ident+"{"+color.normal
         +name
         +color.ident+"}"+color.normal
-        +" "+stat_summary(n_failed, n_total, n_errors);
+        +" "+stat_summary(n_failed, n_total, n_errors)+duration;
       ostringstream this_summary;
       if (n_errors not_eq "0")
         format_error(this_summary, summary_line);
@@ -698,11 +802,14 @@ namespace {
     void try_catch_try(string) override { }
     void try_catch_catch(string, string, string) override { }
     void show_value(string, string) override { }
+    void benchmark(string, string, string, string, string,
+                   string, string, string) override { }
     void begin_with(string, string, string) override { }
     void end_with() override { }
     void begin_with_results() override { }
     void end_with_results() override { }
-    void with_summary(string, string, string, string, string) override { }
+    void with_summary(string, string, string, string, string) override
+      { next_duration.reset(); }
     void check_true(string,
                     string, string, string,
                     string, string) override { }
@@ -719,6 +826,9 @@ namespace {
                     +color.catch_begin+" "+message+" "+color.catch_end));
     }
 
+    void timing(double seconds) override { set_next_duration(seconds); }
+    void slowest_tests(unsigned n) override { format_slowest_tests(ts, n); }
+
   };
 
 
@@ -775,8 +885,10 @@ namespace {
                   (delta_tag(delta_stats)+" "
                    +delta_color(delta_stats)
                    +evolution
-                   +" ("+count+": "
-                   +typeset_from_to(stats_from, stats_to)
+                   +" ("+count
+                   +((stats_from.empty() and stats_to.empty())
+                     ? string()
+                     : ": "+typeset_from_to(stats_from, stats_to))
                    +")"+color.normal));
     }
 
@@ -62,6 +62,13 @@ namespace testudo___implementation {
 
     virtual void show_value(string expr_str, string value_str)=0;
 
+    // if "ns_per_op" is empty, just "code_str" is shown
+    virtual void benchmark(string code_str,
+                           string ns_per_op, string ci_low, string ci_high,
+                           string allocations_per_op,
+                           string n_samples, string iterations,
+                           string n_outliers)=0;
+
     virtual void begin_with(string var_name,
                             string container_first, string container_rest)=0;
     virtual void end_with()=0;
@@ -99,6 +106,13 @@ namespace testudo___implementation {
     virtual void uncaught_exception(string exception)=0;
 
     virtual void aborted(string message)=0;
+
+    // the duration, in seconds, of the test or "with()" loop whose summary
+    // comes next
+    virtual void timing(double seconds)=0;
+    // list the "n" slowest tests without children, among those whose
+    // duration was given
+    virtual void slowest_tests(unsigned n)=0;
   };
 
   class TextTrackTypeset {
@@ -39,6 +39,8 @@ namespace testudo___implementation {
     bool bw=false;
     bool summary=false;
     bool show_lines=true;
+    bool show_timing=false;
+    unsigned n_slowest_tests=0;
     unsigned max_line_length=default_max_line_length;
     while (opts) {
       if (opts.opt("-b"))
@@ -49,6 +51,10 @@ namespace testudo___implementation {
         show_lines=false;
       else if (auto w=opts.opt_arg("-w"))
         max_line_length=stoi(w);
+      else if (auto t=opts.opt_arg("-T")) {
+        show_timing=true;
+        n_slowest_tests=static_cast<unsigned>(stoul(t));
+      }
       else
         throw runtime_error("unknown option \""+opts.arg()+"\"");
     }
@@ -61,6 +67,15 @@ namespace testudo___implementation {
 
     using enc_t=element_t::node_const_t;
 
+    // pass the duration of a test or a "with()" loop, if shown and known
+    auto time=
+      [&](enc_t e) {
+        if (show_timing and has_attribute(e, "start")
+            and has_attribute(e, "end"))
+          typeset->timing(stod(get_attribute(e, "end"))
+                          -stod(get_attribute(e, "start")));
+      };
+
     // wrap an action with location info
     auto locate=
       [&](action_t f) -> action_t {
@@ -102,6 +117,7 @@ namespace testudo___implementation {
       terminal_element(
         "stats",
         [&](enc_t e) {
+          time(e);
           typeset->summary(attribute(e, "name"),
                            attribute(e, "n_failed"),
                            attribute(e, "n_total"),
@@ -163,6 +179,22 @@ namespace testudo___implementation {
           typeset->show_value(text(expr), attribute(expr, "value"));
         }),
 
+      terminal_element(
+        "benchmark",
+        [&](enc_t e) {
+          if (show_timing)
+            typeset->benchmark(text(e),
+                               attribute(e, "ns_per_op"),
+                               attribute(e, "ci_low"),
+                               attribute(e, "ci_high"),
+                               attribute(e, "allocations_per_op"),
+                               attribute(e, "samples"),
+                               attribute(e, "iterations"),
+                               attribute(e, "outliers"));
+          else
+            typeset->benchmark(text(e), "", "", "", "", "", "", "");
+        }),
+
       recursive_element(
         "with",
         [&](enc_t e) {
@@ -175,12 +207,14 @@ namespace testudo___implementation {
       terminal_element(
         "with_stats",
         [&](enc_t e) {
-          if (has_attribute(e, "success"))
+          if (has_attribute(e, "success")) {
+            time(e);
             typeset->with_summary(attribute(e, "name"),
                                   attribute(e, "n_failed"),
                                   attribute(e, "n_total"),
                                   attribute(e, "n_errors"),
                                   attribute(e, "success"));
+          }
         }),
 
       recursive_element(
@@ -253,6 +287,8 @@ namespace testudo___implementation {
       typeset->aborted(
         "incomplete XML report; the test probably crashed!");
     }
+    if (show_timing)
+      typeset->slowest_tests(n_slowest_tests);
   }
 
 }
@@ -2,43 +2,51 @@ TOP_TEST_NODE          TOP_TEST_NODE
 DEFINE_TOP_TEST_NODE   DEFINE_TOP_TEST_NODE
 DEFINE_TEST_NODE       DEFINE_TEST_NODE
 
-DEFINE_TOP_TEST DEFINE_TOP_TEST
-DEFINE_TEST     DEFINE_TEST
-WITH_FIXTURE    WITH_FIXTURE
-VISIBLE_FIXTURE VISIBLE_FIXTURE
-FIXTURE_ARGS    FIXTURE_ARGS
+DEFINE_TOP_TEST      DEFINE_TOP_TEST
+DEFINE_TEST          DEFINE_TEST
+DEFINE_TOP_BENCHMARK DEFINE_TOP_BENCHMARK
+DEFINE_BENCHMARK     DEFINE_BENCHMARK
+WITH_FIXTURE         WITH_FIXTURE
+VISIBLE_FIXTURE      VISIBLE_FIXTURE
+FIXTURE_ARGS         FIXTURE_ARGS
 
 TOUT        TOUT
 TFOS        TFOS
 
-DECLARE              DECLARE
-PERFORM              PERFORM
-FAKE_DECLARE         FAKE_DECLARE
-FAKE_PERFORM         FAKE_PERFORM
-FIXTURE_MEMBER       FIXTURE_MEMBER
-FIXTURE_INIT         FIXTURE_INIT
-WITH_DATA            WITH_DATA
-WITH_MULTILINE_DATA  WITH_MULTILINE_DATA
-CHECK_TRY            CHECK_TRY
-CATCH                CATCH
-SHOW_VALUE           SHOW_VALUE
-IN_SCOPE             IN_SCOPE
-WITH_DECLARE         WITH_DECLARE
+DECLARE                      DECLARE
+PERFORM                      PERFORM
+FAKE_DECLARE                 FAKE_DECLARE
+FAKE_PERFORM                 FAKE_PERFORM
+FIXTURE_MEMBER               FIXTURE_MEMBER
+FIXTURE_INIT                 FIXTURE_INIT
+WITH_DATA                    WITH_DATA
+WITH_MULTILINE_DATA          WITH_MULTILINE_DATA
+PARALLEL_WITH_DATA           PARALLEL_WITH_DATA
+PARALLEL_WITH_MULTILINE_DATA PARALLEL_WITH_MULTILINE_DATA
+CHECK_TRY                    CHECK_TRY
+CATCH                        CATCH
+SHOW_VALUE                   SHOW_VALUE
+IN_SCOPE                     IN_SCOPE
+WITH_DECLARE                 WITH_DECLARE
+BENCHMARK                    BENCHMARK
 
 DEFINE_APPROX_EPSILON DEFINE_APPROX_EPSILON
 SET_APPROX_EPSILON    SET_APPROX_EPSILON
 SHOW_APPROX_EPSILON   SHOW_APPROX_EPSILON
 
-CHECK      CHECK
-PROVIDED   PROVIDED
-TRUE       TRUE
-FALSE      FALSE
-EQUAL      EQUAL
-NOT_EQUAL  NOT_EQUAL
-APPROX     APPROX
-NOT_APPROX NOT_APPROX
-WITH_TOL   WITH_TOL
-SHOW       SHOW
+CHECK         CHECK
+PROVIDED      PROVIDED
+TRUE          TRUE
+FALSE         FALSE
+EQUAL         EQUAL
+NOT_EQUAL     NOT_EQUAL
+APPROX        APPROX
+NOT_APPROX    NOT_APPROX
+WITH_TOL      WITH_TOL
+SHOW          SHOW
+CHECK_TIME    CHECK_TIME
+BELOW         BELOW
+NO_REGRESSION NO_REGRESSION
 
 MOCK_METHOD     MOCK_METHOD
 WRAP_METHOD     WRAP_METHOD